@@ -114,6 +114,7 @@ extern int vx_dump_perf(vx_device_h device, FILE* stream) {
   uint64_t csr_stalls = 0;
   uint64_t alu_stalls = 0;
   uint64_t gpu_stalls = 0;
+  uint64_t sched_stalls = 0;
   // PERF: decode
   uint64_t loads = 0;
   uint64_t stores = 0;
@@ -128,6 +129,8 @@ extern int vx_dump_perf(vx_device_h device, FILE* stream) {
   uint64_t dcache_write_misses = 0;
   uint64_t dcache_bank_stalls = 0;  
   uint64_t dcache_mshr_stalls = 0;
+  uint64_t dcache_prefetches = 0;
+  uint64_t dcache_prefetch_hits = 0;
   // PERF: shared memory
   uint64_t smem_reads = 0;
   uint64_t smem_writes = 0;
@@ -199,6 +202,10 @@ extern int vx_dump_perf(vx_device_h device, FILE* stream) {
     uint64_t gpu_stalls_per_core = get_csr_64(staging_ptr, CSR_MPM_GPU_ST);
     if (num_cores > 1) fprintf(stream, "PERF: core%d: gpu unit stalls=%ld\n", core_id, gpu_stalls_per_core);
     gpu_stalls += gpu_stalls_per_core;  
+    // scheduler_stall
+    uint64_t sched_stalls_per_core = get_csr_64(staging_ptr, CSR_MPM_SCHED_ST);
+    if (num_cores > 1) fprintf(stream, "PERF: core%d: scheduler stalls=%ld\n", core_id, sched_stalls_per_core);
+    sched_stalls += sched_stalls_per_core;
 
     // PERF: decode
     // loads
@@ -253,6 +260,13 @@ extern int vx_dump_perf(vx_device_h device, FILE* stream) {
     uint64_t dcache_mshr_st_per_core = get_csr_64(staging_ptr, CSR_MPM_DCACHE_MSHR_ST);
     if (num_cores > 1) fprintf(stream, "PERF: core%d: dcache mshr stalls=%ld\n", core_id, dcache_mshr_st_per_core);
     dcache_mshr_stalls += dcache_mshr_st_per_core; 
+    // prefetches
+    uint64_t dcache_pref_per_core = get_csr_64(staging_ptr, CSR_MPM_DCACHE_PREF);
+    uint64_t dcache_pref_hit_per_core = get_csr_64(staging_ptr, CSR_MPM_DCACHE_PREF_HIT);
+    int dcache_pref_accuracy = dcache_pref_per_core ? (int)((double(dcache_pref_hit_per_core) / double(dcache_pref_per_core)) * 100) : 0;
+    if (num_cores > 1) fprintf(stream, "PERF: core%d: dcache prefetches=%ld, referenced=%ld (accuracy=%d%%)\n", core_id, dcache_pref_per_core, dcache_pref_hit_per_core, dcache_pref_accuracy);
+    dcache_prefetches += dcache_pref_per_core;
+    dcache_prefetch_hits += dcache_pref_hit_per_core;
 
     // PERF: SMEM
     // total reads
@@ -304,6 +318,9 @@ extern int vx_dump_perf(vx_device_h device, FILE* stream) {
   int dcache_write_hit_ratio = (int)((1.0 - (double(dcache_write_misses) / double(dcache_writes))) * 100);
   int dcache_bank_utilization = (int)((double(dcache_reads + dcache_writes) / double(dcache_reads + dcache_writes + dcache_bank_stalls)) * 100);
   int smem_bank_utilization = (int)((double(smem_reads + smem_writes) / double(smem_reads + smem_writes + smem_bank_stalls)) * 100);
+  // the prefetcher is disabled by default, report 0% when nothing was prefetched
+  int dcache_pref_accuracy = dcache_prefetches ? (int)((double(dcache_prefetch_hits) / double(dcache_prefetches)) * 100) : 0;
+  int dcache_pref_coverage = dcache_prefetch_hits ? (int)((double(dcache_prefetch_hits) / double(dcache_prefetch_hits + dcache_read_misses)) * 100) : 0;
   int mem_avg_lat = (int)(double(mem_lat) / double(mem_reads));
   fprintf(stream, "PERF: ibuffer stalls=%ld\n", ibuffer_stalls);
   fprintf(stream, "PERF: scoreboard stalls=%ld\n", scoreboard_stalls);
@@ -312,6 +329,7 @@ extern int vx_dump_perf(vx_device_h device, FILE* stream) {
   fprintf(stream, "PERF: csr unit stalls=%ld\n", csr_stalls);
   fprintf(stream, "PERF: fpu unit stalls=%ld\n", fpu_stalls);
   fprintf(stream, "PERF: gpu unit stalls=%ld\n", gpu_stalls);
+  fprintf(stream, "PERF: scheduler stalls=%ld\n", sched_stalls);
   fprintf(stream, "PERF: loads=%ld\n", loads);
   fprintf(stream, "PERF: stores=%ld\n", stores);
   fprintf(stream, "PERF: branches=%ld\n", branches);
@@ -323,6 +341,7 @@ extern int vx_dump_perf(vx_device_h device, FILE* stream) {
   fprintf(stream, "PERF: dcache write misses=%ld (hit ratio=%d%%)\n", dcache_write_misses, dcache_write_hit_ratio);  
   fprintf(stream, "PERF: dcache bank stalls=%ld (utilization=%d%%)\n", dcache_bank_stalls, dcache_bank_utilization);
   fprintf(stream, "PERF: dcache mshr stalls=%ld\n", dcache_mshr_stalls);
+  fprintf(stream, "PERF: dcache prefetches=%ld, referenced=%ld (accuracy=%d%%, coverage=%d%%)\n", dcache_prefetches, dcache_prefetch_hits, dcache_pref_accuracy, dcache_pref_coverage);
   fprintf(stream, "PERF: smem reads=%ld\n", smem_reads);
   fprintf(stream, "PERF: smem writes=%ld\n", smem_writes); 
   fprintf(stream, "PERF: smem bank stalls=%ld (utilization=%d%%)\n", smem_bank_stalls, smem_bank_utilization);
@@ -66,6 +66,10 @@
 #define L1_BLOCK_SIZE ((L2_ENABLE || L3_ENABLE) ? 16 : MEM_BLOCK_SIZE)
 #endif
 
+#ifndef MEM_SECTOR_SIZE
+#define MEM_SECTOR_SIZE 16
+#endif
+
 #ifndef STARTUP_ADDR
 #define STARTUP_ADDR 0x80000000
 #endif
@@ -236,6 +240,14 @@
 #define CSR_MPM_TEX_READS_H         0xB9B
 #define CSR_MPM_TEX_LAT             0xB1C     // texture latency
 #define CSR_MPM_TEX_LAT_H           0xB9C
+// PERF: scheduler
+#define CSR_MPM_SCHED_ST            0xB1D     // warp scheduler stalls
+#define CSR_MPM_SCHED_ST_H          0xB9D
+// PERF: dcache prefetcher
+#define CSR_MPM_DCACHE_PREF         0xB1E     // dcache prefetches issued
+#define CSR_MPM_DCACHE_PREF_H       0xB9E
+#define CSR_MPM_DCACHE_PREF_HIT     0xB1F     // dcache prefetches referenced
+#define CSR_MPM_DCACHE_PREF_HIT_H   0xB9F
 
 // Machine Information Registers
 #define CSR_MVENDORID   0xF11
@@ -301,11 +313,41 @@
 #define IBUF_SIZE 2
 #endif
 
+// Number of instructions scheduled, fetched, decoded and issued per cycle
+#ifndef ISSUE_WIDTH
+#define ISSUE_WIDTH 1
+#endif
+
+// Number of register writebacks per cycle
+#ifndef WRITEBACK_PORTS
+#define WRITEBACK_PORTS 1
+#endif
+
+// Branch target buffer entries per warp
+#ifndef BTB_SIZE
+#define BTB_SIZE 16
+#endif
+
+// Cycles to redirect the fetch after a branch misprediction resolves
+#ifndef BRANCH_MISPREDICT_PENALTY
+#define BRANCH_MISPREDICT_PENALTY 2
+#endif
+
 // Size of LSU Request Queue
 #ifndef LSUQ_SIZE
 #define LSUQ_SIZE (NUM_WARPS * 2)
 #endif
 
+// Number of cache lines in the LSU store buffer, 0 to disable
+#ifndef STORE_BUFFER_SIZE
+#define STORE_BUFFER_SIZE 0
+#endif
+
+// Cycles a store buffer line waits for more stores before draining
+#ifndef STORE_BUFFER_WINDOW
+#define STORE_BUFFER_WINDOW 16
+#endif
+
 // Size of FPU Request Queue
 #ifndef FPUQ_SIZE
 #define FPUQ_SIZE 8
@@ -338,6 +380,16 @@
 #define ICACHE_MSHR_SIZE NUM_WARPS
 #endif
 
+// Next-Line Prefetch Depth (0: disabled)
+#ifndef ICACHE_PREFETCH_LINES
+#define ICACHE_PREFETCH_LINES 0
+#endif
+
+// Fills answer waiting requests directly instead of replaying them
+#ifndef ICACHE_DIRECT_FILL
+#define ICACHE_DIRECT_FILL 0
+#endif
+
 // Memory Request Queue Size
 #ifndef ICACHE_MREQ_SIZE
 #define ICACHE_MREQ_SIZE 4
@@ -380,6 +432,41 @@
 #define DCACHE_MSHR_SIZE LSUQ_SIZE
 #endif
 
+// Stride Prefetcher Table Size (0: disabled)
+#ifndef DCACHE_PREFETCH_SIZE
+#define DCACHE_PREFETCH_SIZE 0
+#endif
+
+// Lines Prefetched Ahead per Trained Stream
+#ifndef DCACHE_PREFETCH_DEGREE
+#define DCACHE_PREFETCH_DEGREE 2
+#endif
+
+// Victim Buffer Size (0: disabled)
+#ifndef DCACHE_VICTIM_SIZE
+#define DCACHE_VICTIM_SIZE 0
+#endif
+
+// Victim Buffer Hit Latency
+#ifndef DCACHE_VICTIM_LATENCY
+#define DCACHE_VICTIM_LATENCY 1
+#endif
+
+// Bank Selection Hash (0: bit slice, 1: XOR-folded, 2: prime modulo)
+#ifndef DCACHE_BANK_HASH
+#define DCACHE_BANK_HASH 0
+#endif
+
+// Set Selection Hash (0: bit slice, 1: XOR-folded, 2: prime modulo)
+#ifndef DCACHE_SET_HASH
+#define DCACHE_SET_HASH 0
+#endif
+
+// Sectored Blocks, Fills Fetch Missing Sectors Only
+#ifndef DCACHE_SECTORED
+#define DCACHE_SECTORED 0
+#endif
+
 // Memory Request Queue Size
 #ifndef DCACHE_MREQ_SIZE
 #define DCACHE_MREQ_SIZE 4
@@ -408,6 +495,11 @@
 #define SMEM_NUM_BANKS NUM_THREADS
 #endif
 
+// Bank Selection Hash (0: bit slice, 1: XOR-folded, 2: prime modulo)
+#ifndef SMEM_BANK_HASH
+#define SMEM_BANK_HASH 0
+#endif
+
 // Core Request Queue Size
 #ifndef SMEM_CREQ_SIZE
 #define SMEM_CREQ_SIZE 2
@@ -450,6 +542,21 @@
 #define L2_MSHR_SIZE 16
 #endif
 
+// Number of Ways
+#ifndef L2_NUM_WAYS
+#define L2_NUM_WAYS 1
+#endif
+
+// Replacement Policy (0: LRU, 1: tree-PLRU, 2: SRRIP, 3: BRRIP, 4: random)
+#ifndef L2_REPL_POLICY
+#define L2_REPL_POLICY 0
+#endif
+
+// Sectored Blocks, Fills Fetch Missing Sectors Only
+#ifndef L2_SECTORED
+#define L2_SECTORED 0
+#endif
+
 // Memory Request Queue Size
 #ifndef L2_MREQ_SIZE
 #define L2_MREQ_SIZE 4
@@ -492,6 +599,21 @@
 #define L3_MSHR_SIZE 16
 #endif
 
+// Number of Ways
+#ifndef L3_NUM_WAYS
+#define L3_NUM_WAYS 1
+#endif
+
+// Replacement Policy (0: LRU, 1: tree-PLRU, 2: SRRIP, 3: BRRIP, 4: random)
+#ifndef L3_REPL_POLICY
+#define L3_REPL_POLICY 0
+#endif
+
+// Sectored Blocks, Fills Fetch Missing Sectors Only
+#ifndef L3_SECTORED
+#define L3_SECTORED 0
+#endif
+
 // Memory Request Queue Size
 #ifndef L3_MREQ_SIZE
 #define L3_MREQ_SIZE 4
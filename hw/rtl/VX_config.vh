@@ -61,6 +61,10 @@
 `define L1_BLOCK_SIZE ((`L2_ENABLE || `L3_ENABLE) ? 16 : `MEM_BLOCK_SIZE)
 `endif
 
+`ifndef MEM_SECTOR_SIZE
+`define MEM_SECTOR_SIZE 16
+`endif
+
 `ifndef STARTUP_ADDR
 `define STARTUP_ADDR 32'h80000000
 `endif
@@ -231,6 +235,14 @@
 `define CSR_MPM_TEX_READS_H         12'hB9B
 `define CSR_MPM_TEX_LAT             12'hB1C     // texture latency
 `define CSR_MPM_TEX_LAT_H           12'hB9C
+// PERF: scheduler
+`define CSR_MPM_SCHED_ST            12'hB1D     // warp scheduler stalls
+`define CSR_MPM_SCHED_ST_H          12'hB9D
+// PERF: dcache prefetcher
+`define CSR_MPM_DCACHE_PREF         12'hB1E     // dcache prefetches issued
+`define CSR_MPM_DCACHE_PREF_H       12'hB9E
+`define CSR_MPM_DCACHE_PREF_HIT     12'hB1F     // dcache prefetches referenced
+`define CSR_MPM_DCACHE_PREF_HIT_H   12'hB9F
 
 // Machine Information Registers
 `define CSR_MVENDORID   12'hF11
@@ -296,6 +308,21 @@
 `define IBUF_SIZE 2
 `endif
 
+// Number of instructions scheduled, fetched, decoded and issued per cycle
+`ifndef ISSUE_WIDTH
+`define ISSUE_WIDTH 1
+`endif
+
+// Number of register writebacks per cycle
+`ifndef WRITEBACK_PORTS
+`define WRITEBACK_PORTS 1
+`endif
+
+// Branch target buffer entries per warp
+`ifndef BTB_SIZE
+`define BTB_SIZE 16
+`endif
+
 // Size of LSU Request Queue
 `ifndef LSUQ_SIZE
 `define LSUQ_SIZE (`NUM_WARPS * 2)
@@ -375,6 +402,21 @@
 `define DCACHE_MSHR_SIZE `LSUQ_SIZE
 `endif
 
+// Bank Selection Hash (0: bit slice, 1: XOR-folded, 2: prime modulo)
+`ifndef DCACHE_BANK_HASH
+`define DCACHE_BANK_HASH 0
+`endif
+
+// Set Selection Hash (0: bit slice, 1: XOR-folded, 2: prime modulo)
+`ifndef DCACHE_SET_HASH
+`define DCACHE_SET_HASH 0
+`endif
+
+// Sectored Blocks, Fills Fetch Missing Sectors Only
+`ifndef DCACHE_SECTORED
+`define DCACHE_SECTORED 0
+`endif
+
 // Memory Request Queue Size
 `ifndef DCACHE_MREQ_SIZE
 `define DCACHE_MREQ_SIZE 4
@@ -403,6 +445,11 @@
 `define SMEM_NUM_BANKS `NUM_THREADS
 `endif
 
+// Bank Selection Hash (0: bit slice, 1: XOR-folded, 2: prime modulo)
+`ifndef SMEM_BANK_HASH
+`define SMEM_BANK_HASH 0
+`endif
+
 // Core Request Queue Size
 `ifndef SMEM_CREQ_SIZE
 `define SMEM_CREQ_SIZE 2
@@ -445,6 +492,21 @@
 `define L2_MSHR_SIZE 16
 `endif
 
+// Number of Ways
+`ifndef L2_NUM_WAYS
+`define L2_NUM_WAYS 1
+`endif
+
+// Replacement Policy (0: LRU, 1: tree-PLRU, 2: SRRIP, 3: BRRIP, 4: random)
+`ifndef L2_REPL_POLICY
+`define L2_REPL_POLICY 0
+`endif
+
+// Sectored Blocks, Fills Fetch Missing Sectors Only
+`ifndef L2_SECTORED
+`define L2_SECTORED 0
+`endif
+
 // Memory Request Queue Size
 `ifndef L2_MREQ_SIZE
 `define L2_MREQ_SIZE 4
@@ -487,6 +549,21 @@
 `define L3_MSHR_SIZE 16
 `endif
 
+// Number of Ways
+`ifndef L3_NUM_WAYS
+`define L3_NUM_WAYS 1
+`endif
+
+// Replacement Policy (0: LRU, 1: tree-PLRU, 2: SRRIP, 3: BRRIP, 4: random)
+`ifndef L3_REPL_POLICY
+`define L3_REPL_POLICY 0
+`endif
+
+// Sectored Blocks, Fills Fetch Missing Sectors Only
+`ifndef L3_SECTORED
+`define L3_SECTORED 0
+`endif
+
 // Memory Request Queue Size
 `ifndef L3_MREQ_SIZE
 `define L3_MREQ_SIZE 4
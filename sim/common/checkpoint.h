@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <stdexcept>
+#include <type_traits>
+
+// Binary checkpoint streams.
+// Components write their state as a sequence of tagged sections; the reader
+// validates each tag so that a stale or mismatched checkpoint is rejected
+// instead of silently corrupting the simulation.
+
+class CheckpointError : public std::runtime_error {
+public:
+  CheckpointError(const std::string& what) : std::runtime_error(what) {}
+};
+
+class CheckpointWriter {
+public:
+  CheckpointWriter(std::ostream& os) : os_(os) {}
+
+  void section(const char* tag) {
+    this->write(std::string(tag));
+  }
+
+  template <typename T>
+  void write(const T& value) {
+    static_assert(std::is_trivially_copyable<T>::value, "invalid type");
+    this->write_bytes(&value, sizeof(T));
+  }
+
+  void write(const std::string& value) {
+    this->write<uint32_t>(value.size());
+    this->write_bytes(value.data(), value.size());
+  }
+
+  template <typename T>
+  void write(const std::vector<T>& values) {
+    this->write<uint32_t>(values.size());
+    for (auto& value : values) {
+      this->write(value);
+    }
+  }
+
+  void write_bytes(const void* data, size_t size) {
+    os_.write(reinterpret_cast<const char*>(data), size);
+    if (!os_)
+      throw CheckpointError("checkpoint write failed");
+  }
+
+private:
+  std::ostream& os_;
+};
+
+class CheckpointReader {
+public:
+  CheckpointReader(std::istream& is) : is_(is) {}
+
+  void section(const char* tag) {
+    std::string value;
+    this->read(&value);
+    if (value != tag)
+      throw CheckpointError("checkpoint section '" + std::string(tag) + "' not found");
+  }
+
+  template <typename T>
+  void read(T* value) {
+    static_assert(std::is_trivially_copyable<T>::value, "invalid type");
+    this->read_bytes(value, sizeof(T));
+  }
+
+  void read(std::string* value) {
+    value->resize(this->read<uint32_t>());
+    this->read_bytes(&(*value)[0], value->size());
+  }
+
+  template <typename T>
+  void read(std::vector<T>* values) {
+    values->resize(this->read<uint32_t>());
+    for (auto& value : *values) {
+      this->read(&value);
+    }
+  }
+
+  template <typename T>
+  T read() {
+    T value;
+    this->read(&value);
+    return value;
+  }
+
+  // read a value whose size is fixed by the current configuration
+  template <typename T>
+  void expect(const T& value, const char* what) {
+    if (this->read<T>() != value)
+      throw CheckpointError(std::string("checkpoint ") + what + " mismatch");
+  }
+
+  void read_bytes(void* data, size_t size) {
+    is_.read(reinterpret_cast<char*>(data), size);
+    if (!is_)
+      throw CheckpointError("checkpoint truncated");
+  }
+
+private:
+  std::istream& is_;
+};
@@ -3,7 +3,9 @@
 #include <iostream>
 #include <fstream>
 #include <assert.h>
+#include <string.h>
 #include "util.h"
+#include "checkpoint.h"
 #include <VX_config.h>
 #include <bitset>
 
@@ -121,10 +123,14 @@ void MemoryUnit::ADecoder::write(const void *data, uint64_t addr, uint64_t size)
 MemoryUnit::MemoryUnit(uint64_t pageSize, uint64_t addrBytes)
   : pageSize_(pageSize)
   , addrBytes_(addrBytes)
+  , satp(0)
+  , mode(VA_MODE::BARE)
+  , ptbr(0)
   , TLB_HIT(0)
   , TLB_MISS(0)
   , TLB_EVICT(0)
-  , PTW(0) {};
+  , PTW(0)
+  , PERF_UNIQUE_PTW(0) {};
 
 void MemoryUnit::attach(MemDevice &m, uint64_t start, uint64_t end) {
   decoder_.map(start, end, m);
@@ -239,6 +245,57 @@ void MemoryUnit::tlbAdd(uint64_t vpn, uint64_t pfn, uint32_t flags, uint32_t siz
   tlb_[vpn] = TLBEntry(pfn, flags, size_bits);
 }
 
+void MemoryUnit::save(CheckpointWriter& writer) const {
+  writer.section("mmu");
+  writer.write(satp);
+  writer.write(mode);
+  writer.write(ptbr);
+  writer.write<uint32_t>(tlb_.size());
+  for (auto& entry : tlb_) {
+    writer.write(entry.first);
+    writer.write(entry.second.pfn);
+    writer.write(entry.second.flags);
+    writer.write(entry.second.mru_bit);
+    writer.write(entry.second.size_bits);
+  }
+  writer.write<uint32_t>(unique_translations.size());
+  for (auto addr : unique_translations) {
+    writer.write(addr);
+  }
+  writer.write(TLB_HIT);
+  writer.write(TLB_MISS);
+  writer.write(TLB_EVICT);
+  writer.write(PTW);
+  writer.write(PERF_UNIQUE_PTW);
+}
+
+void MemoryUnit::restore(CheckpointReader& reader) {
+  reader.section("mmu");
+  reader.read(&satp);
+  reader.read(&mode);
+  reader.read(&ptbr);
+  tlb_.clear();
+  for (uint32_t i = 0, n = reader.read<uint32_t>(); i < n; ++i) {
+    auto vpn = reader.read<uint64_t>();
+    auto pfn = reader.read<uint32_t>();
+    auto flags = reader.read<uint8_t>();
+    auto mru_bit = reader.read<bool>();
+    auto size_bits = reader.read<uint32_t>();
+    TLBEntry entry(pfn, flags, size_bits);
+    entry.mru_bit = mru_bit;
+    tlb_[vpn] = entry;
+  }
+  unique_translations.clear();
+  for (uint32_t i = 0, n = reader.read<uint32_t>(); i < n; ++i) {
+    unique_translations.insert(reader.read<uint64_t>());
+  }
+  reader.read(&TLB_HIT);
+  reader.read(&TLB_MISS);
+  reader.read(&TLB_EVICT);
+  reader.read(&PTW);
+  reader.read(&PERF_UNIQUE_PTW);
+}
+
 void MemoryUnit::tlbRm(uint64_t va) {
   if (tlb_.find(va / pageSize_) != tlb_.end())
     tlb_.erase(tlb_.find(va / pageSize_));
@@ -250,7 +307,10 @@ RAM::RAM(uint32_t page_size)
   : size_(0)
   , page_bits_(log2ceil(page_size))
   , last_page_(nullptr)
-  , last_page_index_(0) {    
+  , last_page_index_(0)
+  , clear_version_(0)
+  , code_version_(0)
+  , thread_safe_(false) {    
    assert(ispow2(page_size));
 }
 
@@ -262,6 +322,12 @@ void RAM::clear() {
   for (auto& page : pages_) {
     delete[] page.second;
   }
+  pages_.clear();
+  last_page_ = nullptr;
+  last_page_index_ = 0;
+  code_pages_.clear();
+  written_pages_.clear();
+  clear_version_ = ++code_version_;
 }
 
 uint64_t RAM::size() const {
@@ -296,18 +362,83 @@ uint8_t *RAM::get(uint64_t address) const {
   return page + page_offset;
 }
 
+void RAM::save(CheckpointWriter& writer) const {
+  writer.section("ram");
+  writer.write(page_bits_);
+  writer.write<uint64_t>(pages_.size());
+  for (auto& page : pages_) {
+    writer.write(page.first);
+    writer.write_bytes(page.second, 1 << page_bits_);
+  }
+}
+
+void RAM::restore(CheckpointReader& reader) {
+  reader.section("ram");
+  reader.expect(page_bits_, "page size");
+  this->clear();
+  for (uint64_t i = 0, n = reader.read<uint64_t>(); i < n; ++i) {
+    auto page_index = reader.read<uint64_t>();
+    auto page = new uint8_t[1 << page_bits_];
+    reader.read_bytes(page, 1 << page_bits_);
+    pages_.emplace(page_index, page);
+  }
+}
+
 void RAM::read(void *data, uint64_t addr, uint64_t size) {
+  auto guard = this->lock();
   uint8_t* d = (uint8_t*)data;
+  uint64_t page_mask = (uint64_t(1) << page_bits_) - 1;
+  if (size != 0 && (addr & ~page_mask) == ((addr + size - 1) & ~page_mask)) {
+    // the access stays within one page
+    memcpy(d, this->get(addr), size);
+    return;
+  }
   for (uint64_t i = 0; i < size; i++) {
     d[i] = *this->get(addr + i);
   }
 }
 
 void RAM::write(const void *data, uint64_t addr, uint64_t size) {
+  auto guard = this->lock();
   const uint8_t* d = (const uint8_t*)data;
-  for (uint64_t i = 0; i < size; i++) {
-    *this->get(addr + i) = d[i];
+  uint64_t page_mask = (uint64_t(1) << page_bits_) - 1;
+  if (size != 0 && (addr & ~page_mask) == ((addr + size - 1) & ~page_mask)) {
+    // the access stays within one page
+    memcpy(this->get(addr), d, size);
+  } else {
+    for (uint64_t i = 0; i < size; i++) {
+      *this->get(addr + i) = d[i];
+    }
+  }
+  if (!code_pages_.empty() && size != 0) {
+    bool written = false;
+    for (uint64_t p = addr >> page_bits_, e = (addr + size - 1) >> page_bits_; p <= e; ++p) {
+      if (code_pages_.erase(p)) {
+        if (!written) {
+          ++code_version_;
+          written = true;
+        }
+        written_pages_[p] = code_version_;
+      }
+    }
+  }
+}
+
+void RAM::watch_code(uint64_t addr) {
+  auto guard = this->lock();
+  code_pages_.insert(addr >> page_bits_);
+}
+
+bool RAM::written_code(uint64_t version, std::vector<uint64_t>* pages) {
+  auto guard = this->lock();
+  if (version < clear_version_)
+    return false;
+  for (auto& page : written_pages_) {
+    if (page.second > version) {
+      pages->push_back(page.first << page_bits_);
+    }
   }
+  return true;
 }
 
 void RAM::loadBinImage(const char* filename, uint64_t destination) {
@@ -6,6 +6,11 @@
 #include <unordered_set>
 #include <cstdint>
 #include <stdexcept>
+#include <mutex>
+#include <atomic>
+
+class CheckpointWriter;
+class CheckpointReader;
 
 namespace vortex {
 
@@ -107,6 +112,10 @@ public:
 
   uint32_t get_satp();  
   void set_satp(uint32_t satp);
+
+  void save(CheckpointWriter& writer) const;
+  void restore(CheckpointReader& reader);
+
 private:
 
   class ADecoder {
@@ -205,6 +214,30 @@ public:
   void loadBinImage(const char* filename, uint64_t destination);
   void loadHexImage(const char* filename);
 
+  void save(CheckpointWriter& writer) const;
+  void restore(CheckpointReader& reader);
+
+  uint32_t page_size() const {
+    return 1 << page_bits_;
+  }
+
+  // serializes accesses while cores are simulated on several host threads
+  void set_thread_safe(bool enable) {
+    thread_safe_ = enable;
+  }
+
+  // track writes to the page holding addr; such a write advances
+  // code_version() and stops watching that page
+  void watch_code(uint64_t addr);
+
+  uint64_t code_version() const {
+    return code_version_;
+  }
+
+  // adds the addresses of the code pages written after code_version()
+  // was version; returns false when all code has to be dropped
+  bool written_code(uint64_t version, std::vector<uint64_t>* pages);
+
   uint8_t& operator[](uint64_t address) {
     return *this->get(address);
   }
@@ -217,11 +250,22 @@ private:
 
   uint8_t *get(uint64_t address) const;
 
+  std::unique_lock<std::mutex> lock() {
+    return thread_safe_ ? std::unique_lock<std::mutex>(mutex_) 
+                        : std::unique_lock<std::mutex>();
+  }
+
   uint64_t size_;
   uint32_t page_bits_;  
   mutable std::unordered_map<uint64_t, uint8_t*> pages_;
   mutable uint8_t* last_page_;
   mutable uint64_t last_page_index_;
+  std::unordered_set<uint64_t> code_pages_;
+  std::unordered_map<uint64_t, uint64_t> written_pages_;
+  uint64_t clear_version_;
+  std::atomic<uint64_t> code_version_;
+  std::mutex mutex_;
+  bool thread_safe_;
 };
 
 class PTE_SV32_t 
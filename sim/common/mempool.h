@@ -1,47 +1,114 @@
 #pragma once
 
-#include <stack>
+#include <vector>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
 
+// Slab allocator for objects of type T.
+// Objects are carved from slabs that are only released at exit, so each
+// pool grows to the peak number of live objects and then stops calling
+// into the system allocator. Every thread draws from its own pool; an
+// object remembers its owner and is returned there when released. Threads
+// may therefore free each other's objects, provided they never use the same
+// pool concurrently, which holds for the simulator's alternating parallel
+// and serial phases.
 template <typename T>
-class MemoryPool {
-public:  
-  MemoryPool(uint32_t max_size) : max_size_(max_size) {}
-
-  MemoryPool(MemoryPool && other) 
-    : free_list_(std::move(other.free_list_)) 
-  {}
+class SlabPool {
+public:
+  static void* allocate() {
+    return local().acquire();
+  }
 
-  ~MemoryPool() {
-    this->flush();
+  static void deallocate(void* ptr) {
+    auto slot = reinterpret_cast<slot_t*>(static_cast<char*>(ptr) - offsetof(slot_t, storage));
+    slot->owner->release(slot);
   }
 
-  void* allocate() {
-    void* mem;
-    if (!free_list_.empty()) {
-      mem = static_cast<void*>(free_list_.top());
-      free_list_.pop();
-    } else {
-      mem = ::operator new(sizeof(T));
+  // number of slabs requested from the system allocator
+  static uint64_t slab_allocations() {
+    auto& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    uint64_t count = 0;
+    for (auto pool : reg.pools) {
+      count += pool->num_slabs_;
     }
-    return mem;
+    return count;
   }
 
-  void deallocate(void * object) {
-    if (free_list_.size() < max_size_) {
-      free_list_.push(static_cast<T*>(object));
-    } else {
-      ::operator delete(object);
+private:
+
+  static constexpr uint32_t SLAB_SIZE = 64;
+
+  struct slot_t {
+    SlabPool* owner;
+    slot_t*   next;
+    alignas(T) char storage[sizeof(T)];
+  };
+
+  struct registry_t {
+    std::mutex             mutex;
+    std::vector<SlabPool*> pools;
+    std::vector<SlabPool*> orphans;
+  };
+
+  // binds a pool to the current thread, handing it back on thread exit
+  struct binding_t {
+    SlabPool* pool;
+
+    binding_t() {
+      auto& reg = registry();
+      std::lock_guard<std::mutex> lock(reg.mutex);
+      if (!reg.orphans.empty()) {
+        pool = reg.orphans.back();
+        reg.orphans.pop_back();
+      } else {
+        pool = new SlabPool();
+        reg.pools.push_back(pool);
+      }
     }
-  }
 
-  void flush() {
-    while (!free_list_.empty()) {
-      ::operator delete(free_list_.top());
-      free_list_.pop();
+    ~binding_t() {
+      auto& reg = registry();
+      std::lock_guard<std::mutex> lock(reg.mutex);
+      reg.orphans.push_back(pool);
     }
+  };
+
+  SlabPool() : free_list_(nullptr), num_slabs_(0) {}
+
+  void* acquire() {
+    if (nullptr == free_list_) {
+      auto slab = new slot_t[SLAB_SIZE];
+      for (uint32_t i = 0; i < SLAB_SIZE; ++i) {
+        slab[i].owner = this;
+        slab[i].next  = free_list_;
+        free_list_ = &slab[i];
+      }
+      ++num_slabs_;
+    }
+    auto slot = free_list_;
+    free_list_ = slot->next;
+    return slot->storage;
   }
 
-private:
-  std::stack<void*> free_list_;
-  uint32_t max_size_;
-};
\ No newline at end of file
+  void release(slot_t* slot) {
+    slot->next = free_list_;
+    free_list_ = slot;
+  }
+
+  static SlabPool& local() {
+    static thread_local binding_t binding;
+    return *binding.pool;
+  }
+
+  // pools outlive every thread and static object that may still hold
+  // pooled memory, hence the registry is never destroyed.
+  static registry_t& registry() {
+    static registry_t* reg = new registry_t();
+    return *reg;
+  }
+
+  slot_t*  free_list_;
+  uint64_t num_slabs_;
+};
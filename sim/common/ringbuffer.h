@@ -0,0 +1,105 @@
+#pragma once
+
+#include <vector>
+#include <assert.h>
+
+// Circular FIFO over a power-of-two array.
+// A bounded buffer never exceeds its capacity, while an unbounded one
+// (capacity 0) doubles its storage when it runs out of slots.
+template <typename T>
+class RingBuffer {
+public:
+  RingBuffer(uint32_t capacity = 0)
+    : capacity_(capacity)
+    , head_(0)
+    , size_(0)
+  {
+    uint32_t slots = 1;
+    while (slots < capacity) {
+      slots <<= 1;
+    }
+    buffer_.resize(slots);
+  }
+
+  bool empty() const {
+    return (0 == size_);
+  }
+
+  bool full() const {
+    return (capacity_ != 0) && (size_ >= capacity_);
+  }
+
+  uint32_t size() const {
+    return size_;
+  }
+
+  uint32_t capacity() const {
+    return capacity_;
+  }
+
+  const T& front() const {
+    assert(size_ != 0);
+    return buffer_[head_];
+  }
+
+  T& front() {
+    assert(size_ != 0);
+    return buffer_[head_];
+  }
+
+  const T& back() const {
+    assert(size_ != 0);
+    return buffer_[(head_ + size_ - 1) & this->mask()];
+  }
+
+  T& back() {
+    assert(size_ != 0);
+    return buffer_[(head_ + size_ - 1) & this->mask()];
+  }
+
+  // element at position index from the front
+  const T& at(uint32_t index) const {
+    assert(index < size_);
+    return buffer_[(head_ + index) & this->mask()];
+  }
+
+  void push(const T& value) {
+    assert(!this->full());
+    if (size_ == buffer_.size()) {
+      this->grow();
+    }
+    buffer_[(head_ + size_) & this->mask()] = value;
+    ++size_;
+  }
+
+  void pop() {
+    assert(size_ != 0);
+    head_ = (head_ + 1) & this->mask();
+    --size_;
+  }
+
+  void clear() {
+    head_ = 0;
+    size_ = 0;
+  }
+
+private:
+
+  uint32_t mask() const {
+    return buffer_.size() - 1;
+  }
+
+  void grow() {
+    std::vector<T> buffer(buffer_.size() * 2);
+    for (uint32_t i = 0; i < size_; ++i) {
+      buffer[i] = buffer_[(head_ + i) & this->mask()];
+    }
+    buffer_.swap(buffer);
+    head_ = 0;
+  }
+
+  std::vector<T> buffer_;
+  uint32_t capacity_;
+  uint32_t head_;
+  uint32_t size_;
+};
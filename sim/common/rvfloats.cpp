@@ -1,6 +1,9 @@
 #include "rvfloats.h"
 #include <stdio.h>
 
+// keep softfloat rounding mode and exception flags per host thread
+#define THREAD_LOCAL __thread
+
 extern "C" {
 #include <softfloat.h>
 #include <internals.h>
@@ -1,13 +1,21 @@
 #pragma once
 
+#include <algorithm>
 #include <functional>
 #include <iostream>
 #include <memory>
 #include <vector>
 #include <list>
 #include <queue>
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <condition_variable>
 #include <assert.h>
 #include "mempool.h"
+#include "ringbuffer.h"
+#include "simprofiler.h"
 
 class SimObjectBase;
 
@@ -38,14 +46,38 @@ class SimPort : public SimPortBase {
 public:
   typedef std::function<void (const Pkt&, uint64_t)> TxCallback;
 
-  SimPort(SimObjectBase* module)
+  // a non-zero capacity bounds the number of queued and in-flight packets
+  SimPort(SimObjectBase* module, uint32_t capacity = 0)
     : SimPortBase(module)
+    , queue_(capacity)
+    , inflight_(0)
     , peer_(nullptr)
     , tx_cb_(nullptr)
   {}
 
   void send(const Pkt& pkt, uint64_t delay = 1) const;
 
+  bool try_send(const Pkt& pkt, uint64_t delay = 1) const {
+    if (this->full())
+      return false;
+    this->send(pkt, delay);
+    return true;
+  }
+
+  // number of packets the receiving end can still accept
+  uint32_t available() const {
+    auto sink = this->sink();
+    auto capacity = sink->queue_.capacity();
+    if (0 == capacity)
+      return uint32_t(-1);
+    auto used = sink->queue_.size() + sink->inflight_;
+    return (used < capacity) ? (capacity - used) : 0;
+  }
+
+  bool full() const {
+    return (0 == this->available());
+  }
+
   void bind(SimPort<Pkt>* peer) {
     assert(peer_ == nullptr);
     peer_ = peer;
@@ -68,7 +100,7 @@ public:
   }
 
   const Pkt& front() const {
-    return queue_.front();
+    return queue_.front().pkt;
   }
 
   Pkt& front() {
@@ -76,7 +108,7 @@ public:
   }
 
   const Pkt& back() const {
-    return queue_.back();
+    return queue_.back().pkt;
   }
 
   Pkt& back() {
@@ -89,6 +121,14 @@ public:
     return cycle;
   }  
 
+  uint32_t size() const {
+    return queue_.size();
+  }
+
+  uint32_t capacity() const {
+    return queue_.capacity();
+  }
+
   void tx_callback(const TxCallback& callback) {
     tx_cb_ = callback;
   }
@@ -99,10 +139,20 @@ protected:
     uint64_t cycle;
   };
 
-  std::queue<timed_pkt_t> queue_;
+  RingBuffer<timed_pkt_t> queue_;
+  mutable uint32_t inflight_;
   SimPort*   peer_;
   TxCallback tx_cb_;
 
+  // end of the binding chain, where packets are queued
+  const SimPort* sink() const {
+    auto port = this;
+    while (port->peer_) {
+      port = port->peer_;
+    }
+    return port;
+  }
+
   void push(const Pkt& data, uint64_t cycle) {
     if (tx_cb_) {
       tx_cb_(data, cycle);
@@ -110,6 +160,10 @@ protected:
     if (peer_) {
       peer_->push(data, cycle);
     } else {
+      if (queue_.capacity()) {
+        assert(inflight_ != 0);
+        --inflight_;
+      }
       queue_.push({data, cycle});
     }
   }
@@ -121,10 +175,11 @@ protected:
 
 ///////////////////////////////////////////////////////////////////////////////
 
+// Events are owned by the queue holding them and deleted once fired.
+// Concrete events come from per-type slab pools and carry their own list
+// link, so scheduling involves neither refcounting nor heap allocation.
 class SimEventBase {
 public:
-  typedef std::shared_ptr<SimEventBase> Ptr;
-
   virtual ~SimEventBase() {}
   
   virtual void fire() const = 0;
@@ -134,9 +189,79 @@ public:
   }
 
 protected:
-  SimEventBase(uint64_t time) : time_(time) {}
+  SimEventBase(uint64_t time) 
+    : time_(time)
+    , next_(nullptr) 
+  {}
 
   uint64_t time_;
+
+private:
+  SimEventBase* next_;
+
+  friend class SimEventList;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+// Intrusive FIFO of events.
+class SimEventList {
+public:
+  SimEventList() 
+    : head_(nullptr)
+    , tail_(nullptr) 
+  {}
+
+  SimEventList(SimEventList&& other) noexcept
+    : head_(other.head_)
+    , tail_(other.tail_) {
+    other.head_ = nullptr;
+    other.tail_ = nullptr;
+  }
+
+  ~SimEventList() {
+    this->clear();
+  }
+
+  SimEventList(const SimEventList&) = delete;
+  SimEventList& operator=(const SimEventList&) = delete;
+
+  bool empty() const {
+    return (nullptr == head_);
+  }
+
+  SimEventBase* front() const {
+    return head_;
+  }
+
+  void push_back(SimEventBase* evt) {
+    evt->next_ = nullptr;
+    if (tail_) {
+      tail_->next_ = evt;
+    } else {
+      head_ = evt;
+    }
+    tail_ = evt;
+  }
+
+  SimEventBase* pop_front() {
+    auto evt = head_;
+    head_ = evt->next_;
+    if (nullptr == head_) {
+      tail_ = nullptr;
+    }
+    return evt;
+  }
+
+  void clear() {
+    while (head_) {
+      delete this->pop_front();
+    }
+  }
+
+private:
+  SimEventBase* head_;
+  SimEventBase* tail_;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -157,21 +282,16 @@ public:
   {}
 
   void* operator new(size_t /*size*/) {
-    return allocator().allocate();
+    return SlabPool<SimCallEvent<Pkt>>::allocate();
   }
 
   void operator delete(void* ptr) {
-    allocator().deallocate(ptr);
+    SlabPool<SimCallEvent<Pkt>>::deallocate(ptr);
   }
 
 protected:
   Func func_;
   Pkt  pkt_;
-
-  static MemoryPool<SimCallEvent<Pkt>>& allocator() {
-    static MemoryPool<SimCallEvent<Pkt>> instance(64);
-    return instance;
-  }
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -190,21 +310,250 @@ public:
   {}
 
   void* operator new(size_t /*size*/) {
-    return allocator().allocate();
+    return SlabPool<SimPortEvent<Pkt>>::allocate();
   }
 
   void operator delete(void* ptr) {
-    allocator().deallocate(ptr);
+    SlabPool<SimPortEvent<Pkt>>::deallocate(ptr);
   }
 
 protected:
   const SimPort<Pkt>* port_; 
   Pkt pkt_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+// Calendar queue of pending events.
+// Events due within the wheel horizon are bucketed by their firing cycle,
+// giving O(1) insertion and O(due) firing; far-future events wait in an
+// overflow heap ordered by (time, insertion order).
+class SimEventQueue {
+public:
+  SimEventQueue() 
+    : wheel_(WHEEL_SIZE)
+    , size_(0)
+    , seqnum_(0)
+  {}
+
+  bool empty() const {
+    return (0 == size_);
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+  ~SimEventQueue() {
+    this->clear();
+  }
+
+  void push(SimEventBase* evt, uint64_t cycle) {
+    auto time = evt->time();
+    assert(time > cycle);
+    if ((time - cycle) < WHEEL_SIZE) {
+      wheel_[time & WHEEL_MASK].push_back(evt);
+    } else {
+      overflow_.push({evt, seqnum_++});
+    }
+    ++size_;
+  }
+
+  // firing time of the earliest pending event
+  uint64_t next_time(uint64_t cycle) const {
+    assert(size_ != 0);
+    uint64_t time = uint64_t(-1);
+    if (!overflow_.empty()) {
+      time = overflow_.top().event->time();
+    }
+    for (uint64_t t = cycle, end = std::min(cycle + WHEEL_SIZE, time); t < end; ++t) {
+      if (!wheel_[t & WHEEL_MASK].empty())
+        return t;
+    }
+    return time;
+  }
+
+  void fire(uint64_t cycle, SimProfiler* profiler = nullptr) {
+    // overflow events were scheduled ahead of any bucketed event 
+    // with the same firing time, so they go first to preserve ordering.
+    while (!overflow_.empty() 
+        && overflow_.top().event->time() <= cycle) {
+      auto evt = overflow_.top().event;
+      overflow_.pop();
+      --size_;
+      this->fire_event(evt, profiler);
+    }
+    auto& bucket = wheel_[cycle & WHEEL_MASK];
+    while (!bucket.empty()) {
+      auto evt = bucket.pop_front();
+      assert(evt->time() == cycle);
+      --size_;
+      this->fire_event(evt, profiler);
+    }
+  }
+
+  void clear() {
+    for (auto& bucket : wheel_) {
+      bucket.clear();
+    }
+    while (!overflow_.empty()) {
+      delete overflow_.top().event;
+      overflow_.pop();
+    }
+    size_ = 0;
+    seqnum_ = 0;
+  }
+
+private:
+
+  static void fire_event(SimEventBase* evt, SimProfiler* profiler) {
+    if (profiler) {
+      auto start = SimProfiler::now();
+      evt->fire();
+      profiler->add_event(typeid(*evt), SimProfiler::now() - start);
+    } else {
+      evt->fire();
+    }
+    delete evt;
+  }
+
+  static constexpr uint64_t WHEEL_SIZE = 256;
+  static constexpr uint64_t WHEEL_MASK = WHEEL_SIZE - 1;
+
+  struct overflow_entry_t {
+    SimEventBase* event;
+    uint64_t seqnum;
+  };
+
+  struct overflow_cmp_t {
+    bool operator()(const overflow_entry_t& a, const overflow_entry_t& b) const {
+      if (a.event->time() != b.event->time())
+        return a.event->time() > b.event->time();
+      return a.seqnum > b.seqnum;
+    }
+  };
+
+  typedef std::priority_queue<overflow_entry_t, 
+                              std::vector<overflow_entry_t>, 
+                              overflow_cmp_t> overflow_queue_t;
+
+  std::vector<SimEventList> wheel_;
+  overflow_queue_t overflow_;
+  size_t   size_;
+  uint64_t seqnum_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+// Fixed pool of host threads executing a task in lock-step.
+// run() hands the task to every worker, executes slot 0 on the calling 
+// thread and spins until all workers are done. Idle workers spin briefly
+// for the next task, then sleep until run() or the destructor wakes them.
+class SimWorkerPool {
+public:
+  typedef std::function<void (uint32_t)> Task;
+
+  SimWorkerPool(uint32_t num_threads)
+    : task_(nullptr)
+    , generation_(0)
+    , pending_(0)
+    , sleepers_(0)
+    , stop_(false)
+  {
+    assert(num_threads != 0);
+    for (uint32_t i = 1; i < num_threads; ++i) {
+      workers_.emplace_back(&SimWorkerPool::worker_loop, this, i);
+    }
+  }
+
+  ~SimWorkerPool() {
+    {
+      std::lock_guard<std::mutex> lock(wait_mutex_);
+      stop_ = true;
+    }
+    wait_cv_.notify_all();
+    for (auto& worker : workers_) {
+      worker.join();
+    }
+  }
 
-  static MemoryPool<SimPortEvent<Pkt>>& allocator() {
-    static MemoryPool<SimPortEvent<Pkt>> instance(64);
-    return instance;
+  uint32_t num_threads() const {
+    return workers_.size() + 1;
+  }
+
+  void run(const Task& task) {
+    task_ = &task;
+    pending_.store(workers_.size(), std::memory_order_relaxed);
+    generation_.fetch_add(1);
+    if (sleepers_.load() != 0) {
+      std::lock_guard<std::mutex> lock(wait_mutex_);
+      wait_cv_.notify_all();
+    }
+    this->execute(0);
+    while (pending_.load(std::memory_order_acquire) != 0) {
+      std::this_thread::yield();
+    }
+    if (error_) {
+      auto error = error_;
+      error_ = nullptr;
+      std::rethrow_exception(error);
+    }
   }
+
+private:
+
+  // yields before an idle worker goes to sleep
+  static constexpr uint32_t SPIN_LIMIT = 1024;
+
+  void execute(uint32_t tid) {
+    try {
+      (*task_)(tid);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(error_mutex_);
+      if (!error_) {
+        error_ = std::current_exception();
+      }
+    }
+  }
+
+  bool wait(uint64_t generation) {
+    for (uint32_t i = 0; i < SPIN_LIMIT; ++i) {
+      if (generation_.load(std::memory_order_acquire) != generation)
+        return true;
+      if (stop_)
+        return false;
+      std::this_thread::yield();
+    }
+    std::unique_lock<std::mutex> lock(wait_mutex_);
+    // run() checks sleepers_ after publishing the task, so either it sees
+    // this worker and wakes it, or the new generation is visible below
+    sleepers_.fetch_add(1);
+    wait_cv_.wait(lock, [&]() {
+      return generation_.load() != generation || stop_;
+    });
+    sleepers_.fetch_sub(1);
+    return generation_.load(std::memory_order_acquire) != generation;
+  }
+
+  void worker_loop(uint32_t tid) {
+    uint64_t generation = 0;
+    while (this->wait(generation)) {
+      generation = generation_.load(std::memory_order_acquire);
+      this->execute(tid);
+      pending_.fetch_sub(1, std::memory_order_release);
+    }
+  }
+
+  std::vector<std::thread> workers_;
+  const Task*              task_;
+  std::atomic<uint64_t>    generation_;
+  std::atomic<uint32_t>    pending_;
+  std::atomic<uint32_t>    sleepers_;
+  std::atomic<bool>        stop_;
+  std::exception_ptr       error_;
+  std::mutex               error_mutex_;
+  std::mutex               wait_mutex_;
+  std::condition_variable  wait_cv_;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -231,7 +580,14 @@ private:
 
   virtual void do_tick() = 0;
 
+  virtual bool do_idle() const = 0;
+
+  virtual bool do_can_advance() const = 0;
+
+  virtual void do_advance(uint64_t until) = 0;
+
   std::string name_;
+  SimProfiler::counter_t profile_;
 
   friend class SimPlatform;
 };
@@ -246,6 +602,26 @@ public:
   template <typename... Args>
   static Ptr Create(Args&&... args);
 
+  // Objects report whether tick() has any work to do this cycle.
+  // Idle objects are skipped, and when every object is idle the platform
+  // fast-forwards to the next scheduled event. The default is always busy.
+  bool idle() const {
+    return false;
+  }
+
+  // Objects whose remaining work needs no further input, such as a DRAM
+  // model serving queued requests, can still let the platform fast-forward.
+  // When every other object is idle, advance() simulates the skipped 
+  // cycles up to cycle until in bulk; it may stop early once it has 
+  // scheduled an output. The default must be ticked every cycle.
+  bool can_advance() const {
+    return false;
+  }
+
+  void advance(uint64_t until) {
+    (void)until;
+  }
+
 protected:
 
   SimObject(const SimContext& ctx, const char* name) 
@@ -269,6 +645,18 @@ private:
   void do_tick() override {
     this->impl()->tick();
   }
+
+  bool do_idle() const override {
+    return this->impl()->idle();
+  }
+
+  bool do_can_advance() const override {
+    return this->impl()->can_advance();
+  }
+
+  void do_advance(uint64_t until) override {
+    this->impl()->advance(until);
+  }
 };
 
 class SimContext {
@@ -300,49 +688,173 @@ public:
   typename SimObject<Impl>::Ptr create_object(Args&&... args) {
     auto obj = std::make_shared<Impl>(SimContext{}, std::forward<Args>(args)...);
     objects_.push_back(obj);
+    if (cur_shard_ >= 0) {
+      shards_.at(cur_shard_).objects.push_back(obj.get());
+    } else {
+      global_objects_.push_back(obj.get());
+    }
     return obj;
   }
 
   void release_object(const SimObjectBase::Ptr& object) {
+    for (auto& shard : shards_) {
+      shard.objects.remove(object.get());
+    }
+    global_objects_.remove(object.get());
     objects_.remove(object);
   }
 
+  // Objects created while a shard is selected belong to that shard.
+  // Shards only talk to each other and to global objects through ports,
+  // which lets the parallel engine tick them concurrently.
+  void begin_shard(uint32_t shard) {
+    if (shard >= shards_.size()) {
+      shards_.resize(shard + 1);
+    }
+    cur_shard_ = shard;
+  }
+
+  void end_shard() {
+    cur_shard_ = -1;
+  }
+
+  // Run callback serially at the end of every cycle, after all objects 
+  // have ticked. Callbacks registered while a shard is selected run in 
+  // shard order, so effects that other shards can observe (e.g. stores 
+  // to shared memory) are published in the same order in serial and 
+  // parallel runs.
+  void on_cycle_end(const std::function<void ()>& callback) {
+    if (cur_shard_ >= 0) {
+      shards_.at(cur_shard_).cycle_end.push_back(callback);
+    } else {
+      cycle_end_.push_back(callback);
+    }
+  }
+
+  // Tick shards on the given number of host threads.
+  // Sharded objects are evaluated before global objects each cycle, 
+  // matching the serial order when all shards are created first.
+  void set_num_threads(uint32_t num_threads) {
+    workers_.reset();
+    num_threads = std::min<uint32_t>(num_threads, shards_.size());
+    if (num_threads > 1) {
+      workers_ = std::unique_ptr<SimWorkerPool>(new SimWorkerPool(num_threads));
+    }
+  }
+
+  uint32_t num_threads() const {
+    return workers_ ? workers_->num_threads() : 1;
+  }
+
   template <typename Pkt>
   void schedule(const typename SimCallEvent<Pkt>::Func& callback,
                 const Pkt& pkt, 
                 uint64_t delay) {    
     assert(delay != 0);
-    auto evt = std::make_shared<SimCallEvent<Pkt>>(callback, pkt, cycles_ + delay);    
-    events_.emplace_back(evt);
+    auto evt = new SimCallEvent<Pkt>(callback, pkt, cycles_ + delay);    
+    this->push_event(evt);
   }
 
-  void reset() {
+  // objects are reset after the clock, so they can align to the start cycle
+  void reset(uint64_t cycle = 0) {
     events_.clear();
+    for (auto& shard : shards_) {
+      shard.events.clear();
+    }
+    cycles_ = cycle;
     for (auto& object : objects_) {
       object->do_reset();
     }
-    cycles_ = 0;
+  }
+
+  // true when no object has work and no event is pending
+  bool idle() const {
+    if (!events_.empty())
+      return false;
+    for (auto& object : objects_) {
+      if (!object->do_idle())
+        return false;
+    }
+    return true;
+  }
+
+  // accumulate host time per object and per event type
+  void enable_profiling(bool enable) {
+    if (enable) {
+      profiler_ = std::unique_ptr<SimProfiler>(new SimProfiler());
+      for (auto& object : objects_) {
+        object->profile_ = SimProfiler::counter_t();
+      }
+    } else {
+      profiler_.reset();
+    }
+  }
+
+  bool profiling() const {
+    return (profiler_ != nullptr);
+  }
+
+  void dump_profile(std::ostream& os) const {
+    if (!profiler_)
+      return;
+    SimProfiler::table_t objects;
+    for (auto& object : objects_) {
+      objects.emplace_back(object->name(), object->profile_);
+    }
+    profiler_->report(os, objects);
   }
 
   void tick() {
+    uint64_t start = 0;
+    if (profiler_) {
+      start = SimProfiler::now();
+    }
     // evaluate events
-    auto evt_it = events_.begin();
-    auto evt_it_end = events_.end();
-    while (evt_it != evt_it_end) {
-      auto& event = *evt_it;
-      if (cycles_ >= event->time()) {        
-        event->fire();
-        evt_it = events_.erase(evt_it);
-      } else {        
-        ++evt_it;
+    events_.fire(cycles_, profiler_.get());
+    // evaluate components
+    bool busy = false;
+    bool blocking = false;
+    if (workers_) {
+      workers_->run(shard_task_);
+      // merge events scheduled by shards in serial order
+      for (auto& shard : shards_) {
+        while (!shard.events.empty()) {
+          events_.push(shard.events.pop_front(), cycles_);
+        }
+        busy |= shard.busy;
+        blocking |= shard.blocking;
+      }
+      for (auto object : global_objects_) {
+        busy |= tick_object(object, &blocking);
+      }
+    } else {
+      for (auto& object : objects_) {
+        busy |= tick_object(object.get(), &blocking);
       }
     }
-    // evaluate components
-    for (auto& object : objects_) {
-      object->do_tick();
+    // publish cross-shard effects in serial order
+    for (auto& shard : shards_) {
+      for (auto& callback : shard.cycle_end) {
+        callback();
+      }
+    }
+    for (auto& callback : cycle_end_) {
+      callback();
     }
     // advance clock    
     ++cycles_;
+    // objects left with work of their own catch up in bulk
+    if (busy && !blocking) {
+      this->advance_objects();
+      busy = false;
+    }
+    // nothing ran this cycle, so nothing can change until the next event
+    if (!busy && !events_.empty()) {
+      cycles_ = events_.next_time(cycles_);
+    }
+    if (profiler_) {
+      profiler_->add_tick(SimProfiler::now() - start);
+    }
   }
 
   uint64_t cycles() const {
@@ -351,26 +863,110 @@ public:
 
 private:
 
-  SimPlatform() : cycles_(0) {}
+  struct shard_t {
+    std::list<SimObjectBase*>      objects;
+    std::vector<std::function<void ()>> cycle_end;
+    SimEventList                   events;
+    bool                           busy;
+    bool                           blocking;
+    shard_t() : busy(false), blocking(false) {}
+  };
+
+  SimPlatform() 
+    : cur_shard_(-1)
+    , cycles_(0) {
+    shard_task_ = [this](uint32_t tid) {
+      // evaluate a contiguous range of shards on this thread
+      uint32_t num_shards = shards_.size();
+      uint32_t num_threads = workers_->num_threads();
+      uint32_t begin = (tid * num_shards) / num_threads;
+      uint32_t end = ((tid + 1) * num_shards) / num_threads;
+      for (uint32_t i = begin; i < end; ++i) {
+        auto& shard = shards_.at(i);
+        active_shard() = &shard;
+        shard.busy = false;
+        shard.blocking = false;
+        for (auto object : shard.objects) {
+          shard.busy |= tick_object(object, &shard.blocking);
+        }
+      }
+      active_shard() = nullptr;
+    };
+  }
 
   virtual ~SimPlatform() {
     this->clear();
   }
 
   void clear() {
+    profiler_.reset();
+    workers_.reset();
+    shards_.clear();
+    global_objects_.clear();
+    cycle_end_.clear();
     objects_.clear();
     events_.clear();
+    cur_shard_ = -1;
+  }
+
+  bool tick_object(SimObjectBase* object, bool* blocking) const {
+    if (object->do_idle())
+      return false;
+    if (profiler_) {
+      auto start = SimProfiler::now();
+      object->do_tick();
+      object->profile_.add(SimProfiler::now() - start);
+    } else {
+      object->do_tick();
+    }
+    if (!object->do_can_advance()) {
+      *blocking = true;
+    }
+    return true;
+  }
+
+  // run the objects that still have work up to the next event, 
+  // which may come from the objects themselves
+  void advance_objects() {
+    for (auto& object : objects_) {
+      if (object->do_idle())
+        continue;
+      uint64_t until = events_.empty() ? uint64_t(-1) : events_.next_time(cycles_);
+      object->do_advance(until);
+    }
   }
 
   template <typename Pkt>
   void schedule(const SimPort<Pkt>* port, const Pkt& pkt, uint64_t delay) {
     assert(delay != 0);
-    auto evt = SimEventBase::Ptr(new SimPortEvent<Pkt>(port, pkt, cycles_ + delay));
-    events_.emplace_back(evt);
+    auto evt = new SimPortEvent<Pkt>(port, pkt, cycles_ + delay);
+    this->push_event(evt);
+  }
+
+  void push_event(SimEventBase* evt) {
+    // events raised by a shard worker are staged until the cycle completes
+    auto shard = active_shard();
+    if (shard) {
+      shard->events.push_back(evt);
+    } else {
+      events_.push(evt, cycles_);
+    }
+  }
+
+  static shard_t*& active_shard() {
+    static thread_local shard_t* s_shard = nullptr;
+    return s_shard;
   }
 
   std::list<SimObjectBase::Ptr> objects_;
-  std::list<SimEventBase::Ptr> events_;
+  std::vector<shard_t> shards_;
+  std::list<SimObjectBase*> global_objects_;
+  std::vector<std::function<void ()>> cycle_end_;
+  int cur_shard_;
+  std::unique_ptr<SimWorkerPool> workers_;
+  SimWorkerPool::Task shard_task_;
+  SimEventQueue events_;
+  std::unique_ptr<SimProfiler> profiler_;
   uint64_t cycles_;
 
   template <typename U> friend class SimPort;
@@ -391,9 +987,16 @@ typename SimObject<Impl>::Ptr SimObject<Impl>::Create(Args&&... args) {
 
 template <typename Pkt>
 void SimPort<Pkt>::send(const Pkt& pkt, uint64_t delay) const {
-  if (peer_ && !tx_cb_) {
-    reinterpret_cast<const SimPort<Pkt>*>(peer_)->send(pkt, delay);    
-  } else {
-    SimPlatform::instance().schedule(this, pkt, delay);
-  }  
+  // reserve a slot at the receiving end
+  auto sink = this->sink();
+  if (sink->queue_.capacity()) {
+    assert(!sink->full());
+    ++sink->inflight_;
+  }
+  // schedule on the first port that observes transmissions
+  auto port = this;
+  while (port->peer_ && !port->tx_cb_) {
+    port = port->peer_;
+  }
+  SimPlatform::instance().schedule(port, pkt, delay);
 }
\ No newline at end of file
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <map>
+#include <typeinfo>
+#include <typeindex>
+#include <unordered_map>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <stdlib.h>
+#include <cxxabi.h>
+
+// Host-time accounting for the simulation kernel.
+// Object counters live in each object, so shards ticking on different host
+// threads never share one; event counters are only updated by the serial
+// event loop. Times are host nanoseconds summed over all threads.
+class SimProfiler {
+public:
+  struct counter_t {
+    uint64_t ns;
+    uint64_t calls;
+
+    counter_t() : ns(0), calls(0) {}
+
+    void add(uint64_t elapsed) {
+      ns += elapsed;
+      ++calls;
+    }
+
+    counter_t& operator+=(const counter_t& other) {
+      ns += other.ns;
+      calls += other.calls;
+      return *this;
+    }
+  };
+
+  typedef std::vector<std::pair<std::string, counter_t>> table_t;
+
+  static uint64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  void add_tick(uint64_t elapsed) {
+    ticks_.add(elapsed);
+  }
+
+  void add_event(const std::type_info& type, uint64_t elapsed) {
+    events_[std::type_index(type)].add(elapsed);
+  }
+
+  void clear() {
+    ticks_ = counter_t();
+    events_.clear();
+  }
+
+  // objects holding the same name are reported as one entry
+  void report(std::ostream& os, const table_t& objects) const {
+    std::map<std::string, counter_t> by_name;
+    for (auto& object : objects) {
+      by_name[object.first] += object.second;
+    }
+    table_t events;
+    for (auto& event : events_) {
+      events.emplace_back(demangle(event.first.name()), event.second);
+    }
+    os << "profile: " << ticks_.calls << " ticks, "
+       << std::fixed << std::setprecision(3) << (ticks_.ns * 1e-6) << " ms" << std::endl;
+    print_table(os, "object", table_t(by_name.begin(), by_name.end()));
+    print_table(os, "event", events);
+    os.unsetf(std::ios::floatfield);
+  }
+
+private:
+
+  void print_table(std::ostream& os, const char* title, table_t table) const {
+    std::sort(table.begin(), table.end(), [](const table_t::value_type& a, const table_t::value_type& b) {
+      return a.second.ns > b.second.ns;
+    });
+    os << std::left << std::setw(48) << title << std::right
+       << std::setw(14) << "calls" << std::setw(14) << "ms"
+       << std::setw(10) << "ns/call" << std::setw(8) << "%" << std::endl;
+    for (auto& entry : table) {
+      auto& counter = entry.second;
+      os << std::left << std::setw(48) << entry.first << std::right
+         << std::setw(14) << counter.calls
+         << std::setw(14) << std::setprecision(3) << (counter.ns * 1e-6)
+         << std::setw(10) << std::setprecision(1) << (counter.calls ? double(counter.ns) / counter.calls : 0)
+         << std::setw(8) << std::setprecision(1) << (ticks_.ns ? 100.0 * counter.ns / ticks_.ns : 0)
+         << std::endl;
+    }
+  }
+
+  static std::string demangle(const char* name) {
+    int status = 0;
+    char* buf = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+    if (0 != status)
+      return name;
+    std::string ret(buf);
+    free(buf);
+    return ret;
+  }
+
+  counter_t ticks_;
+  std::unordered_map<std::type_index, counter_t> events_;
+};
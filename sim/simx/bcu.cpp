@@ -1,6 +1,11 @@
 #include "bcu.h"
 
+#include <algorithm>
+
+#include <checkpoint.h>
+
 #include "core.h"
+#include "constants.h"
 
 using namespace vortex;
 
@@ -8,9 +13,9 @@ BcuUnit::BcuUnit(const SimContext& ctx, Core* core, const char* name)
     : SimObject<BcuUnit>(ctx, name),
       pending_reqs_(BCUQ_SIZE),
       l1_rcache_(RbtCache::Create(core, "l1_rcache", "l1_rcache",
-                                  RbtCache::Config{16384, 1, 1, false})),
+                                  RbtCache::Config{16384, 1, 1, false, L1_QUEUE_SIZE})),
       l2_rcache_(RbtCache::Create(core, "l2_rcache", "l2_rcache",
-                                  RbtCache::Config{16384, 1, core->rbt_mem_->latency_, false})),
+                                  RbtCache::Config{16384, 1, core->rbt_mem_->latency_, false, 0})),
       Input(this),
       Output(this),
       core_(core) {
@@ -65,12 +70,31 @@ void BcuUnit::tick() {
     if (Input.empty()) return;
 
     auto trace = Input.front();
-    if (trace->mem_addrs.size() == 0) return;
 
-    auto mem_addr = trace->mem_addrs.at(0).at(0);
+    // fences carry no addresses
+    auto addrs_it = std::find_if(trace->mem_addrs.begin(), trace->mem_addrs.end(),
+        [](const ThreadMemAddrs& addrs) { return !addrs.empty(); });
+    if (addrs_it == trace->mem_addrs.end()) {
+        Input.pop();
+        return;
+    }
+
+    auto mem_addr = addrs_it->at(0);
 
     if (buffer_id_map_.count(mem_addr.addr)) {
         DT(1, "bcu: valid buffer id found");
+
+        // stall on rcache backpressure
+        auto& rcache_req_port = l1_rcache_->BcuReqPort;
+        if (rcache_req_port.full()) {
+            if (!trace->suspend()) {
+                DT(1, "*** bcu-rcache-stall: " << *trace);
+            }
+            return;
+        } else {
+            trace->resume();
+        }
+
         auto tag = pending_reqs_.allocate({trace, 1});
         DT(1, "bcu-req: addr=0x" << std::hex << mem_addr.addr << ", " << tag
                                  << ", " << *trace);
@@ -81,7 +105,7 @@ void BcuUnit::tick() {
         mem_req.tag = tag;
         mem_req.uuid = trace->uuid;
 
-        l1_rcache_->BcuReqPort.send(mem_req, 1);
+        rcache_req_port.send(mem_req, 1);
     } else {
         DT(1, "bcu: no buffer id for addr " << std::hex << mem_addr.addr << ", "
                                             << *trace);
@@ -186,6 +210,44 @@ void RbtCache::tick() {
 
 const RbtCache::PerfStats& RbtCache::perf_stats() const { return perf_stats_; }
 
+void RbtCache::save(CheckpointWriter& writer) const {
+    writer.section("rcache");
+    // cached entries are referenced by buffer id
+    writer.write<uint32_t>(cache_set_.size());
+    for (auto entry : cache_set_) {
+        writer.write(entry->buffer_id);
+    }
+    writer.write<uint32_t>(pending_reqs_.size());
+    for (auto& req : pending_reqs_) {
+        writer.write(req);
+    }
+    writer.write(perf_stats_);
+}
+
+void RbtCache::restore(CheckpointReader& reader) {
+    reader.section("rcache");
+    cache_set_.clear();
+    for (uint32_t i = 0, n = reader.read<uint32_t>(); i < n; ++i) {
+        auto buffer_id = reader.read<decltype(RbtEntry::buffer_id)>();
+        cache_set_.push_back(&core_->rbt_mem_->rbt_.at(buffer_id));
+    }
+    pending_reqs_.clear();
+    for (uint32_t i = 0, n = reader.read<uint32_t>(); i < n; ++i) {
+        pending_reqs_.push_back(reader.read<RbtEntryReq>());
+    }
+    reader.read(&perf_stats_);
+}
+
+void BcuUnit::save(CheckpointWriter& writer) const {
+    l1_rcache_->save(writer);
+    l2_rcache_->save(writer);
+}
+
+void BcuUnit::restore(CheckpointReader& reader) {
+    l1_rcache_->restore(reader);
+    l2_rcache_->restore(reader);
+}
+
 void RbtMem::tick() {
     // DT(1, "rbtmem tick");
     // handle incoming BCU requests
@@ -18,6 +18,7 @@ public:
         uint8_t latency;
         uint64_t lower_level_latency;
         bool lru; // lru if true, fifo if false
+        uint32_t queue_size; // request queue size (0: unbounded)
     };
     
     struct PerfStats {
@@ -47,7 +48,7 @@ public:
 
     RbtCache(const SimContext& ctx, Core* core, const char* name, std::string print_name, const Config& config) 
         : SimObject<RbtCache>(ctx, name)    
-        , BcuReqPort(this)
+        , BcuReqPort(this, config.queue_size)
         , BcuRspPort(this)
         // , MemReqPort(this)
         // , MemRspPort(this)
@@ -58,10 +59,18 @@ public:
     {}
 
     void reset();
+
+    bool idle() const {
+        return MemRspPort->empty() && BcuReqPort.empty();
+    }
     
     void tick();
 
     const PerfStats& perf_stats() const;
+
+    void save(CheckpointWriter& writer) const;
+
+    void restore(CheckpointReader& reader);
     
 private:
     Config config_;
@@ -88,8 +97,16 @@ public:
 
     void reset() {}
 
+    bool idle() const {
+        return l1_rcache_->BcuRspPort.empty() && Input.empty();
+    }
+
     void tick();
 
+    void save(CheckpointWriter& writer) const;
+
+    void restore(CheckpointReader& reader);
+
 private:
     Core* core_;
 
@@ -135,6 +152,10 @@ public:
 
     void reset(){}
 
+    bool idle() const {
+        return RcacheReqPort.empty();
+    }
+
 private:
     uint64_t latency_;
 
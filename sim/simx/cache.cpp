@@ -2,10 +2,15 @@
 #include "debug.h"
 #include "types.h"
 #include <util.h>
+#include <checkpoint.h>
+#include <ringbuffer.h>
 #include <unordered_map>
 #include <vector>
 #include <list>
 #include <queue>
+#include <algorithm>
+#include <bitset>
+#include <memory>
 
 using namespace vortex;
 
@@ -27,12 +32,17 @@ struct params_t {
     uint32_t tag_select_addr_start;
     uint32_t tag_select_addr_end;
 
+    // hashed indexing keeps the whole line address as tag
+    IndexHasher bank_hasher;
+    IndexHasher set_hasher;
+    bool hashed;
+
     params_t(const Cache::Config& config) {
         uint32_t bank_bits   = log2ceil(config.num_banks);
         uint32_t offset_bits = config.B - config.W;
         uint32_t log2_bank_size  = config.C - bank_bits;
-        uint32_t index_bits  = log2_bank_size - (config.B << config.A);        
-        assert(log2_bank_size >= config.B);   
+        assert(log2_bank_size >= (uint32_t)(config.B + config.A));   
+        uint32_t index_bits  = log2_bank_size - (config.B + config.A);        
 
         this->log2_num_inputs = log2ceil(config.num_inputs);
 
@@ -57,9 +67,16 @@ struct params_t {
         // Tag select
         this->tag_select_addr_start = (1+this->set_select_addr_end);
         this->tag_select_addr_end = (config.addr_width-1);
+
+        this->bank_hasher = IndexHasher(config.bank_hash, config.num_banks);
+        this->set_hasher  = IndexHasher(config.set_hash, this->sets_per_bank);
+        this->hashed = (config.bank_hash != IndexHash::None)
+                    || (config.set_hash != IndexHash::None);
     }
 
     uint32_t addr_bank_id(uint64_t word_addr) const {
+        if (bank_hasher.hash() != IndexHash::None)
+            return bank_hasher(bit_getw(word_addr, bank_select_addr_start, tag_select_addr_end));
         if (bank_select_addr_end >= bank_select_addr_start)
             return (uint32_t)bit_getw(word_addr, bank_select_addr_start, bank_select_addr_end);
         else    
@@ -67,6 +84,8 @@ struct params_t {
     }
 
     uint32_t addr_set_id(uint64_t word_addr) const {
+        if (set_hasher.hash() != IndexHash::None)
+            return set_hasher(bit_getw(word_addr, set_select_addr_start, tag_select_addr_end));
         if (set_select_addr_end >= set_select_addr_start)
             return (uint32_t)bit_getw(word_addr, set_select_addr_start, set_select_addr_end);
         else
@@ -74,6 +93,8 @@ struct params_t {
     }
 
     uint64_t addr_tag(uint64_t word_addr) const {
+        if (hashed)
+            return bit_getw(word_addr, bank_select_addr_start, tag_select_addr_end);
         if (tag_select_addr_end >= tag_select_addr_start)
             return bit_getw(word_addr, tag_select_addr_start, tag_select_addr_end);
         else    
@@ -82,6 +103,8 @@ struct params_t {
     
     uint64_t mem_addr(uint32_t bank_id, uint32_t set_id, uint64_t tag) const {
         uint64_t addr(0);
+        if (hashed)
+            return bit_setw(addr, bank_select_addr_start, tag_select_addr_end, tag);
         if (bank_select_addr_end >= bank_select_addr_start)            
             addr = bit_setw(addr, bank_select_addr_start, bank_select_addr_end, bank_id);
         if (set_select_addr_end >= set_select_addr_start)
@@ -95,14 +118,24 @@ struct params_t {
 struct block_t {
     bool     valid;
     bool     dirty;        
+    bool     prefetched;    // filled by a prefetch, not referenced yet
     uint64_t tag;
-    uint32_t lru_ctr;
+    uint64_t sectors;       // valid sectors
+    uint64_t used;          // sectors read since the block was filled
 };
 
 struct set_t {
     std::vector<block_t> blocks;    
     set_t(uint32_t size) : blocks(size) {}
 
+    bool contains(uint64_t tag) const {
+        for (auto& block : blocks) {
+            if (block.valid && block.tag == tag)
+                return true;
+        }
+        return false;
+    }
+
     void clear() {
         for (auto& block : blocks) {
             block.valid = false;
@@ -110,6 +143,306 @@ struct set_t {
     }
 };
 
+// Array of fixed-width fields packed into 64-bit words.
+class bit_array_t {
+private:
+    std::vector<uint64_t> words_;
+    uint32_t width_;
+    uint32_t fields_per_word_;
+
+public:
+    bit_array_t(uint32_t size, uint32_t width)
+        : width_(std::max<uint32_t>(width, 1))
+        , fields_per_word_(64 / width_)
+    {
+        words_.resize((size + fields_per_word_ - 1) / fields_per_word_);
+    }
+
+    uint32_t get(uint32_t index) const {
+        uint32_t shift = (index % fields_per_word_) * width_;
+        return (words_.at(index / fields_per_word_) >> shift) & ((1ull << width_) - 1);
+    }
+
+    void set(uint32_t index, uint32_t value) {
+        uint32_t shift = (index % fields_per_word_) * width_;
+        uint64_t mask = ((1ull << width_) - 1) << shift;
+        auto& word = words_.at(index / fields_per_word_);
+        word = (word & ~mask) | ((uint64_t(value) << shift) & mask);
+    }
+
+    void clear() {
+        for (auto& word : words_) {
+            word = 0;
+        }
+    }
+
+    void save(CheckpointWriter& writer) const {
+        writer.write(words_);
+    }
+
+    void restore(CheckpointReader& reader) {
+        reader.expect<uint32_t>(words_.size(), "replacement state size");
+        for (auto& word : words_) {
+            reader.read(&word);
+        }
+    }
+};
+
+// Replacement policy of the blocks of each set.
+// Invalid blocks are always filled first; the policy only picks among the
+// valid blocks of a full set.
+class ReplacementPolicy {
+public:
+    typedef std::unique_ptr<ReplacementPolicy> Ptr;
+
+    static Ptr Create(ReplPolicy policy, uint32_t num_sets, uint32_t num_ways);
+
+    virtual ~ReplacementPolicy() {}
+
+    // block referenced by a hit
+    virtual void touch(uint32_t set_id, uint32_t way) = 0;
+
+    // block filled after a miss
+    virtual void fill(uint32_t set_id, uint32_t way) = 0;
+
+    // block to evict from a full set
+    virtual uint32_t victim(uint32_t set_id) = 0;
+
+    virtual void clear() = 0;
+
+    virtual void save(CheckpointWriter& writer) const = 0;
+
+    virtual void restore(CheckpointReader& reader) = 0;
+};
+
+// True LRU keeping the age rank of each block.
+class LruPolicy : public ReplacementPolicy {
+private:
+    bit_array_t ages_;
+    uint32_t num_sets_;
+    uint32_t num_ways_;
+
+public:
+    LruPolicy(uint32_t num_sets, uint32_t num_ways) 
+        : ages_(num_sets * num_ways, log2ceil(num_ways))
+        , num_sets_(num_sets)
+        , num_ways_(num_ways)
+    {
+        this->clear();
+    }
+
+    void touch(uint32_t set_id, uint32_t way) override {
+        uint32_t base = set_id * num_ways_;
+        uint32_t age = ages_.get(base + way);
+        for (uint32_t i = 0; i < num_ways_; ++i) {
+            uint32_t other = ages_.get(base + i);
+            if (other < age) {
+                ages_.set(base + i, other + 1);
+            }
+        }
+        ages_.set(base + way, 0);
+    }
+
+    void fill(uint32_t set_id, uint32_t way) override {
+        this->touch(set_id, way);
+    }
+
+    uint32_t victim(uint32_t set_id) override {
+        uint32_t base = set_id * num_ways_;
+        for (uint32_t i = 0; i < num_ways_; ++i) {
+            if (ages_.get(base + i) == num_ways_ - 1)
+                return i;
+        }
+        return 0;
+    }
+
+    void clear() override {
+        for (uint32_t s = 0; s < num_sets_; ++s) {
+            for (uint32_t i = 0; i < num_ways_; ++i) {
+                ages_.set(s * num_ways_ + i, i);
+            }
+        }
+    }
+
+    void save(CheckpointWriter& writer) const override {
+        ages_.save(writer);
+    }
+
+    void restore(CheckpointReader& reader) override {
+        ages_.restore(reader);
+    }
+};
+
+// Tree pseudo-LRU with one bit per internal node, pointing to the
+// subtree to evict from.
+class PlruPolicy : public ReplacementPolicy {
+private:
+    bit_array_t bits_;
+    uint32_t num_ways_;
+    uint32_t levels_;
+
+public:
+    PlruPolicy(uint32_t num_sets, uint32_t num_ways) 
+        : bits_(num_sets * num_ways, 1)
+        , num_ways_(num_ways)
+        , levels_(log2ceil(num_ways))
+    {}
+
+    void touch(uint32_t set_id, uint32_t way) override {
+        uint32_t base = set_id * num_ways_;
+        uint32_t node = 1;
+        for (uint32_t l = levels_; l-- > 0;) {
+            uint32_t dir = (way >> l) & 1;
+            bits_.set(base + node, !dir);
+            node = 2 * node + dir;
+        }
+    }
+
+    void fill(uint32_t set_id, uint32_t way) override {
+        this->touch(set_id, way);
+    }
+
+    uint32_t victim(uint32_t set_id) override {
+        uint32_t base = set_id * num_ways_;
+        uint32_t node = 1;
+        for (uint32_t l = 0; l < levels_; ++l) {
+            node = 2 * node + bits_.get(base + node);
+        }
+        return node - num_ways_;
+    }
+
+    void clear() override {
+        bits_.clear();
+    }
+
+    void save(CheckpointWriter& writer) const override {
+        bits_.save(writer);
+    }
+
+    void restore(CheckpointReader& reader) override {
+        bits_.restore(reader);
+    }
+};
+
+// 2-bit re-reference interval prediction.
+// SRRIP inserts blocks with a long re-reference interval, so blocks that
+// are not reused age out before the working set. BRRIP inserts them with
+// a distant interval except for one fill in BIMODAL_PERIOD, which keeps
+// streaming scans from flushing the set.
+class RripPolicy : public ReplacementPolicy {
+private:
+    static constexpr uint32_t RRPV_BITS = 2;
+    static constexpr uint32_t RRPV_MAX = (1 << RRPV_BITS) - 1;
+    static constexpr uint32_t BIMODAL_PERIOD = 32;
+
+    bit_array_t rrpvs_;
+    uint32_t num_ways_;
+    bool bimodal_;
+    uint32_t fill_ctr_;
+
+public:
+    RripPolicy(uint32_t num_sets, uint32_t num_ways, bool bimodal) 
+        : rrpvs_(num_sets * num_ways, RRPV_BITS)
+        , num_ways_(num_ways)
+        , bimodal_(bimodal)
+    {
+        this->clear();
+    }
+
+    void touch(uint32_t set_id, uint32_t way) override {
+        rrpvs_.set(set_id * num_ways_ + way, 0);
+    }
+
+    void fill(uint32_t set_id, uint32_t way) override {
+        uint32_t rrpv = RRPV_MAX - 1;
+        if (bimodal_) {
+            fill_ctr_ = (fill_ctr_ + 1) % BIMODAL_PERIOD;
+            if (fill_ctr_ != 0) {
+                rrpv = RRPV_MAX;
+            }
+        }
+        rrpvs_.set(set_id * num_ways_ + way, rrpv);
+    }
+
+    uint32_t victim(uint32_t set_id) override {
+        uint32_t base = set_id * num_ways_;
+        for (;;) {
+            for (uint32_t i = 0; i < num_ways_; ++i) {
+                if (rrpvs_.get(base + i) == RRPV_MAX)
+                    return i;
+            }
+            for (uint32_t i = 0; i < num_ways_; ++i) {
+                rrpvs_.set(base + i, rrpvs_.get(base + i) + 1);
+            }
+        }
+    }
+
+    void clear() override {
+        rrpvs_.clear();
+        fill_ctr_ = 0;
+    }
+
+    void save(CheckpointWriter& writer) const override {
+        rrpvs_.save(writer);
+        writer.write(fill_ctr_);
+    }
+
+    void restore(CheckpointReader& reader) override {
+        rrpvs_.restore(reader);
+        reader.read(&fill_ctr_);
+    }
+};
+
+// Pseudo-random eviction from a xorshift generator, no per-set state.
+class RandomPolicy : public ReplacementPolicy {
+private:
+    static constexpr uint32_t SEED = 0x2545f491;
+
+    uint32_t num_ways_;
+    uint32_t state_;
+
+public:
+    RandomPolicy(uint32_t num_ways) 
+        : num_ways_(num_ways)
+        , state_(SEED)
+    {}
+
+    void touch(uint32_t /*set_id*/, uint32_t /*way*/) override {}
+
+    void fill(uint32_t /*set_id*/, uint32_t /*way*/) override {}
+
+    uint32_t victim(uint32_t /*set_id*/) override {
+        state_ ^= state_ << 13;
+        state_ ^= state_ >> 17;
+        state_ ^= state_ << 5;
+        return state_ % num_ways_;
+    }
+
+    void clear() override {
+        state_ = SEED;
+    }
+
+    void save(CheckpointWriter& writer) const override {
+        writer.write(state_);
+    }
+
+    void restore(CheckpointReader& reader) override {
+        reader.read(&state_);
+    }
+};
+
+ReplacementPolicy::Ptr ReplacementPolicy::Create(ReplPolicy policy, uint32_t num_sets, uint32_t num_ways) {
+    switch (policy) {
+    case ReplPolicy::LRU:    return Ptr(new LruPolicy(num_sets, num_ways));
+    case ReplPolicy::PLRU:   return Ptr(new PlruPolicy(num_sets, num_ways));
+    case ReplPolicy::SRRIP:  return Ptr(new RripPolicy(num_sets, num_ways, false));
+    case ReplPolicy::BRRIP:  return Ptr(new RripPolicy(num_sets, num_ways, true));
+    case ReplPolicy::RANDOM: return Ptr(new RandomPolicy(num_ways));
+    }
+    std::abort();
+    return nullptr;
+}
+
 struct bank_req_info_t {
     bool     valid;    
     uint32_t req_id;
@@ -120,43 +453,107 @@ struct bank_req_t {
     bool valid;
     bool write;
     bool mshr_replay;
+    bool prefetch;
     uint64_t tag;
     uint32_t set_id;
     uint32_t core_id;
     uint64_t uuid;
+    uint64_t sectors;   // sectors of the block accessed
     std::vector<bank_req_info_t> infos;
 
     bank_req_t(uint32_t size) 
         : valid(false)
         , write(false)
         , mshr_replay(false)
+        , prefetch(false)
         , tag(0)
         , set_id(0)
         , core_id(0)
         , uuid(0)
+        , sectors(0)
         , infos(size)
     {}
+
+    void clear() {
+        valid = false;
+        mshr_replay = false;
+        prefetch = false;
+        for (auto& info : infos) {
+            info.valid = false;
+        }
+    }
 };
 
 struct mshr_entry_t : public bank_req_t {
     uint32_t block_id;
+    uint32_t root;      // entry that sent the fill this one waits on
+    uint64_t fill;      // sectors fetched, root entries only
 
     mshr_entry_t(uint32_t size = 0) 
         : bank_req_t(size) 
         , block_id(0)
+        , root(0)
+        , fill(0)
     {}
 };
 
+// Miss status holding registers.
+// Entries are chained per set in allocation order, so lookups only visit
+// the entries of one set; free slots and entries ready for replay are kept
+// in queues. Each fill is sent by a root entry, and a block may have
+// several fills in flight for different sectors.
 class MSHR {
 private:
     std::vector<mshr_entry_t> entries_;
+    std::vector<int32_t> set_heads_;    // first entry of each set, -1 if none
+    std::vector<int32_t> next_;         // next entry of the same set
+    std::vector<uint32_t> free_;        // stack of free entries
+    std::vector<uint32_t> replay_;      // ring of entries to replay
+    uint32_t replay_head_;
+    uint32_t replay_size_;
     uint32_t size_;
 
+    void push_replay(uint32_t id) {
+        replay_.at((replay_head_ + replay_size_) % replay_.size()) = id;
+        ++replay_size_;
+    }
+
+    void unlink(uint32_t id) {
+        auto& entry = entries_.at(id);
+        int32_t* link = &set_heads_.at(entry.set_id);
+        while (*link != (int32_t)id) {
+            link = &next_.at(*link);
+        }
+        *link = next_.at(id);
+    }
+
+    void release(uint32_t id) {
+        this->unlink(id);
+        entries_.at(id).valid = false;
+        free_.push_back(id);
+        --size_;
+    }
+
+    void link(uint32_t id) {
+        auto& entry = entries_.at(id);
+        next_.at(id) = -1;
+        int32_t* link = &set_heads_.at(entry.set_id);
+        while (*link != -1) {
+            link = &next_.at(*link);
+        }
+        *link = id;
+    }
+
 public:    
-    MSHR(uint32_t size)
+    MSHR(uint32_t size, uint32_t num_sets)
         : entries_(size)
-        , size_(0) 
-    {}
+        , set_heads_(num_sets)
+        , next_(size)
+        , replay_(size)
+    {
+        free_.reserve(size);
+        this->clear();
+    }
 
     bool empty() const {
         return (0 == size_);
@@ -166,81 +563,378 @@ public:
         return (size_ == entries_.size());
     }
 
-    int lookup(const bank_req_t& bank_req) {
-         for (uint32_t i = 0, n = entries_.size(); i < n; ++i) {
-            auto& entry = entries_.at(i);
-            if (entry.valid 
-             && entry.set_id == bank_req.set_id 
-             && entry.tag == bank_req.tag) {
+    uint32_t available() const {
+        return entries_.size() - size_;
+    }
+
+    mshr_entry_t& at(uint32_t id) {
+        return entries_.at(id);
+    }
+
+    int lookup(uint32_t set_id, uint64_t tag) const {
+        for (int32_t i = set_heads_.at(set_id); i != -1; i = next_.at(i)) {
+            if (entries_.at(i).tag == tag)
                 return i;
-            }
         }
         return -1;
     }
 
-    int allocate(const bank_req_t& bank_req, uint32_t block_id) {
-        for (uint32_t i = 0, n = entries_.size(); i < n; ++i) {
+    // returns the root entry of a fill covering the sectors
+    int lookup(uint32_t set_id, uint64_t tag, uint64_t sectors) const {
+        for (int32_t i = set_heads_.at(set_id); i != -1; i = next_.at(i)) {
             auto& entry = entries_.at(i);
-            if (!entry.valid) {
-                *(bank_req_t*)&entry = bank_req;
-                entry.valid = true;
-                entry.mshr_replay = false;
-                entry.block_id = block_id;  
-                ++size_;              
+            if (entry.tag == tag 
+             && entry.root == (uint32_t)i
+             && (entry.fill & sectors) == sectors)
                 return i;
-            }
         }
         return -1;
     }
 
+    // allocates an entry waiting on root, or a new root if -1
+    int allocate(const bank_req_t& bank_req, uint32_t block_id, int root, uint64_t fill) {
+        if (free_.empty())
+            return -1;
+        uint32_t id = free_.back();
+        free_.pop_back();
+        auto& entry = entries_.at(id);
+        *(bank_req_t*)&entry = bank_req;
+        entry.valid = true;
+        entry.mshr_replay = false;
+        entry.block_id = block_id;
+        entry.root = (root == -1) ? id : root;
+        entry.fill = (root == -1) ? fill : 0;
+        this->link(id);
+        ++size_;
+        return id;
+    }
+
     mshr_entry_t& replay(uint32_t id) {
         auto& root_entry = entries_.at(id);
         assert(root_entry.valid);
-        // make all related mshr entries for replay
-        for (auto& entry : entries_) {
-            if (entry.valid 
-             && entry.set_id == root_entry.set_id 
-             && entry.tag == root_entry.tag) {
+        // make all entries waiting on this fill for replay
+        for (int32_t i = set_heads_.at(root_entry.set_id); i != -1; i = next_.at(i)) {
+            auto& entry = entries_.at(i);
+            if (entry.root == id && !entry.mshr_replay) {
                 entry.mshr_replay = true;
+                this->push_replay(i);
             }
         }
         return root_entry;
     }
 
+    // releases the entries waiting on the fill of id
+    template <typename F>
+    void retire(uint32_t id, const F& fn) {
+        auto& root_entry = entries_.at(id);
+        assert(root_entry.valid);
+        auto set_id = root_entry.set_id;
+        for (int32_t i = set_heads_.at(set_id); i != -1;) {
+            int32_t next = next_.at(i);
+            auto& entry = entries_.at(i);
+            if (entry.root == id) {
+                fn(entry);
+                this->release(i);
+            }
+            i = next;
+        }
+    }
+
     bool pop(bank_req_t* out) {
+        if (0 == replay_size_)
+            return false;
+        uint32_t id = replay_.at(replay_head_);
+        replay_head_ = (replay_head_ + 1) % replay_.size();
+        --replay_size_;
+        *out = entries_.at(id);
+        this->release(id);
+        return true;
+    }
+
+    bool has_replay() const {
+        return (replay_size_ != 0);
+    }
+
+    void clear() {
+        free_.clear();
+        for (uint32_t i = entries_.size(); i-- > 0;) {
+            entries_.at(i).valid = false;
+            free_.push_back(i);
+        }
+        for (auto& head : set_heads_) {
+            head = -1;
+        }
+        replay_head_ = 0;
+        replay_size_ = 0;
+        size_ = 0;
+    }
+
+    void save(CheckpointWriter& writer) const {
+        writer.write(size_);
         for (auto& entry : entries_) {
-            if (entry.valid && entry.mshr_replay) {
-                *out = entry;
-                entry.valid = false;
-                --size_;
+            writer.write(entry.valid);
+            if (!entry.valid)
+                continue;
+            writer.write(entry.write);
+            writer.write(entry.mshr_replay);
+            writer.write(entry.prefetch);
+            writer.write(entry.tag);
+            writer.write(entry.set_id);
+            writer.write(entry.core_id);
+            writer.write(entry.uuid);
+            writer.write(entry.sectors);
+            writer.write(entry.infos);
+            writer.write(entry.block_id);
+            writer.write(entry.root);
+            writer.write(entry.fill);
+        }
+    }
+
+    void restore(CheckpointReader& reader) {
+        this->clear();
+        free_.clear();
+        reader.read(&size_);
+        for (uint32_t i = 0, n = entries_.size(); i < n; ++i) {
+            auto& entry = entries_.at(i);
+            reader.read(&entry.valid);
+            if (!entry.valid)
+                continue;
+            reader.read(&entry.write);
+            reader.read(&entry.mshr_replay);
+            reader.read(&entry.prefetch);
+            reader.read(&entry.tag);
+            reader.read(&entry.set_id);
+            reader.read(&entry.core_id);
+            reader.read(&entry.uuid);
+            reader.read(&entry.sectors);
+            reader.read(&entry.infos);
+            reader.read(&entry.block_id);
+            reader.read(&entry.root);
+            reader.read(&entry.fill);
+            this->link(i);
+            if (entry.mshr_replay) {
+                this->push_replay(i);
+            }
+        }
+        for (uint32_t i = entries_.size(); i-- > 0;) {
+            if (!entries_.at(i).valid) {
+                free_.push_back(i);
+            }
+        }
+    }
+};
+
+// Queues lines to prefetch. A per-PC stride detector queues the lines
+// ahead of a load PC once it repeats the same stride, and the next-line
+// mode queues the lines following each newly accessed line.
+class Prefetcher {
+private:
+    static constexpr uint32_t MAX_CONFIDENCE = 3;
+    static constexpr uint32_t MIN_CONFIDENCE = 2;
+
+    struct entry_t {
+        uint64_t pc;
+        uint64_t addr;
+        int64_t  stride;
+        uint64_t uuid;
+        uint32_t confidence;
+    };
+
+    std::vector<entry_t> entries_;
+    RingBuffer<uint64_t> queue_;
+    uint32_t log2_block_size_;
+    uint32_t degree_;
+    uint32_t next_lines_;
+    uint64_t last_line_;
+
+    void push(uint64_t line) {
+        uint64_t addr = line << log2_block_size_;
+        for (uint32_t i = 0, n = queue_.size(); i < n; ++i) {
+            if (queue_.at(i) == addr)
+                return;
+        }
+        if (queue_.full()) {
+            queue_.pop();
+        }
+        queue_.push(addr);
+    }
+
+public:
+    Prefetcher(const Cache::Config& config)
+        : entries_(config.prefetch_size)
+        , queue_(2 * std::max(config.prefetch_degree, config.next_lines))
+        , log2_block_size_(config.B)
+        , degree_(config.prefetch_degree)
+        , next_lines_(config.next_lines)
+        , last_line_(UINT64_MAX)
+    {}
+
+    bool empty() const {
+        return queue_.empty();
+    }
+
+    uint64_t front() const {
+        return queue_.front();
+    }
+
+    void pop() {
+        queue_.pop();
+    }
+
+    void train(uint64_t pc, uint64_t addr, uint64_t uuid) {
+        if (next_lines_ != 0) {
+            uint64_t line = addr >> log2_block_size_;
+            if (line != last_line_) {
+                for (uint32_t i = 1; i <= next_lines_; ++i) {
+                    this->push(line + i);
+                }
+                last_line_ = line;
+            }
+        }
+        if (entries_.empty() || 0 == pc)
+            return;
+        auto& entry = entries_.at((pc >> 2) % entries_.size());
+        if (entry.pc != pc) {
+            entry = {pc, addr, 0, uuid, 0};
+            return;
+        }
+        // other lines of the same warp access
+        if (entry.uuid == uuid)
+            return;
+        int64_t stride = addr - entry.addr;
+        uint64_t prev_line = entry.addr >> log2_block_size_;
+        uint64_t line = addr >> log2_block_size_;
+        if (stride != 0 && stride == entry.stride) {
+            entry.confidence += (entry.confidence < MAX_CONFIDENCE);
+        } else {
+            entry.stride = stride;
+            entry.confidence = 0;
+        }
+        entry.addr = addr;
+        entry.uuid = uuid;
+        if (entry.confidence < MIN_CONFIDENCE || line == prev_line)
+            return;
+        // small strides walk the next lines of the stream
+        int64_t block_size = int64_t(1) << log2_block_size_;
+        int64_t step = (stride >= block_size || stride <= -block_size) ? stride : 
+                       (stride > 0 ? block_size : -block_size);
+        for (uint32_t i = 1; i <= degree_; ++i) {
+            this->push((addr + i * step) >> log2_block_size_);
+        }
+    }
+
+    void clear() {
+        for (auto& entry : entries_) {
+            entry = {0, 0, 0, 0, 0};
+        }
+        queue_.clear();
+        last_line_ = UINT64_MAX;
+    }
+};
+
+// Fully-associative buffer of the blocks evicted from a bank.
+// Evicted blocks are kept with their set index, and a hit swaps the block
+// back into its set in exchange for the block it replaces.
+class VictimCache {
+private:
+    struct entry_t {
+        block_t  block;
+        uint32_t set_id;
+        uint32_t lru_ctr;
+    };
+
+    std::vector<entry_t> entries_;
+
+public:
+    VictimCache(uint32_t size) : entries_(size) {
+        this->clear();
+    }
+
+    bool enabled() const {
+        return !entries_.empty();
+    }
+
+    bool contains(uint32_t set_id, uint64_t tag) const {
+        for (auto& entry : entries_) {
+            if (entry.block.valid 
+             && entry.set_id == set_id
+             && entry.block.tag == tag)
                 return true;
+        }
+        return false;
+    }
+
+    // inserts an evicted block, returns true with the displaced victim
+    bool insert(uint32_t set_id, const block_t& block, block_t* evicted) {
+        entry_t* repl = nullptr;
+        for (auto& entry : entries_) {
+            if (!entry.block.valid) {
+                repl = &entry;
+                break;
             }
+            ++entry.lru_ctr;
+            if (repl == nullptr || repl->lru_ctr < entry.lru_ctr) {
+                repl = &entry;
+            }
+        }
+        bool has_evicted = repl->block.valid;
+        if (has_evicted) {
+            *evicted = repl->block;
+        }
+        repl->block = block;
+        repl->lru_ctr = 0;
+        repl->set_id = set_id;
+        return has_evicted;
+    }
+
+    // moves a matching block into *block, which goes to the buffer if valid
+    bool swap(uint32_t set_id, uint64_t tag, block_t* block) {
+        for (auto& entry : entries_) {
+            if (!entry.block.valid 
+             || entry.set_id != set_id
+             || entry.block.tag != tag)
+                continue;
+            std::swap(entry.block, *block);
+            entry.lru_ctr = 0;
+            return true;
         }
         return false;
     }
 
     void clear() {
         for (auto& entry : entries_) {
-            if (entry.valid && entry.mshr_replay) {
-                entry.valid = false;
-            }
+            entry.block.valid = false;
+            entry.lru_ctr = 0;
+        }
+    }
+
+    void save(CheckpointWriter& writer) const {
+        writer.write(entries_);
+    }
+
+    void restore(CheckpointReader& reader) {
+        reader.expect<uint32_t>(entries_.size(), "victim cache size");
+        for (auto& entry : entries_) {
+            reader.read(&entry);
         }
-        size_ = 0;
     }
 };
 
 struct bank_t {
     std::vector<set_t>  sets;    
     MSHR                mshr;
+    VictimCache         victims;
 
     bank_t(const Cache::Config& config, 
            const params_t& params) 
         : sets(params.sets_per_bank, params.blocks_per_set)
-        , mshr(config.mshr_size)
+        , mshr(config.mshr_size, params.sets_per_bank)
+        , victims(config.victim_size)
     {}
 
     void clear() {
         mshr.clear();
+        victims.clear();
         for (auto& set : sets) {
             set.clear();
         }
@@ -255,15 +949,23 @@ private:
     Config config_;
     params_t params_;
     std::vector<bank_t> banks_;
+    ReplacementPolicy::Ptr repl_policy_;
+    Prefetcher prefetcher_;
     Switch<MemReq, MemRsp>::Ptr mem_switch_;    
     Switch<MemReq, MemRsp>::Ptr bypass_switch_;
     std::vector<SimPort<MemReq>> mem_req_ports_;
     std::vector<SimPort<MemRsp>>  mem_rsp_ports_;
+    std::vector<bank_req_t> pipeline_reqs_; // per-bank pipeline request
+    std::vector<bool> bank_fills_;          // per-bank fill this cycle
     uint32_t flush_cycles_;
     PerfStats perf_stats_;
+    std::vector<uint64_t> bank_conflicts_;  // bank stalls per bank
+    uint64_t full_sectors_;     // sector mask of a whole block
+    uint32_t sector_size_;      // bytes per sector
     uint64_t pending_read_reqs_;
     uint64_t pending_write_reqs_;
     uint64_t pending_fill_reqs_;    
+    uint64_t last_tick_cycle_;
 
 public:
     Impl(Cache* simobject, const Config& config) 
@@ -271,8 +973,15 @@ public:
         , config_(config)
         , params_(config)
         , banks_(config.num_banks, {config, params_})
+        , repl_policy_(ReplacementPolicy::Create(config.repl_policy, 
+                                                 config.num_banks * params_.sets_per_bank, 
+                                                 params_.blocks_per_set))
+        , prefetcher_(config)
         , mem_req_ports_(config.num_banks, simobject)
         , mem_rsp_ports_(config.num_banks, simobject)
+        , pipeline_reqs_(config.num_banks, config.ports_per_bank)
+        , bank_fills_(config.num_banks)
+        , bank_conflicts_(config.num_banks)
     {
         bypass_switch_ = Switch<MemReq, MemRsp>::Create("bypass_arb", ArbiterType::Priority, 2);
         bypass_switch_->ReqOut.bind(&simobject->MemReqPort);
@@ -293,16 +1002,48 @@ public:
 
         // calculate tag flush cycles
         flush_cycles_ = params_.sets_per_bank * params_.blocks_per_set;
+
+        // sectors are MEM_SECTOR_SIZE bytes, smaller blocks have a single sector
+        uint32_t block_size = 1 << config.B;
+        uint32_t num_sectors = std::max<uint32_t>(block_size / MEM_SECTOR_SIZE, 1);
+        assert(block_size <= MEM_BLOCK_SIZE);
+        full_sectors_ = (num_sectors < 64) ? ((uint64_t(1) << num_sectors) - 1) : ~uint64_t(0);
+        sector_size_ = block_size / num_sectors;
     }
 
     void reset() {
         for (auto& bank : banks_) {
             bank.clear();
         }
+        prefetcher_.clear();
+        repl_policy_->clear();
         perf_stats_ = PerfStats();
+        for (auto& count : bank_conflicts_) {
+            count = 0;
+        }
         pending_read_reqs_ = 0;
         pending_write_reqs_ = 0;
         pending_fill_reqs_ = 0;
+        last_tick_cycle_ = SimPlatform::instance().cycles();
+    }
+
+    bool idle() const {
+        if (flush_cycles_ != 0)
+            return false;
+        if (!bypass_switch_->RspOut.at(1).empty())
+            return false;
+        if (!prefetcher_.empty())
+            return false;
+        for (uint32_t bank_id = 0, n = config_.num_banks; bank_id < n; ++bank_id) {
+            if (!mem_rsp_ports_.at(bank_id).empty()
+             || banks_.at(bank_id).mshr.has_replay())
+                return false;
+        }
+        for (auto& core_req_port : simobject_->CoreReqPorts) {
+            if (!core_req_port.empty())
+                return false;
+        }
+        return true;
     }
 
     void tick() {
@@ -312,11 +1053,15 @@ public:
             return;
         }
 
-        // per-bank pipeline request
-        std::vector<bank_req_t> pipeline_reqs(config_.num_banks, config_.ports_per_bank);
+        // clear the per-bank pipeline requests
+        for (auto& pipeline_req : pipeline_reqs_) {
+            pipeline_req.clear();
+        }
 
-        // calculate memory latency
-        perf_stats_.mem_latency += pending_fill_reqs_;
+        // calculate memory latency, including idle cycles that were skipped
+        auto cycle = SimPlatform::instance().cycles();
+        perf_stats_.mem_latency += pending_fill_reqs_ * (cycle - last_tick_cycle_);
+        last_tick_cycle_ = cycle;
 
         // handle bypasss responses
         auto& bypass_port = bypass_switch_->RspOut.at(1);            
@@ -333,18 +1078,18 @@ public:
         // handle MSHR replay
         for (uint32_t bank_id = 0, n = config_.num_banks; bank_id < n; ++bank_id) {
             auto& bank = banks_.at(bank_id);
-            auto& pipeline_req = pipeline_reqs.at(bank_id);
+            auto& pipeline_req = pipeline_reqs_.at(bank_id);
             bank.mshr.pop(&pipeline_req);
         }       
 
         // handle memory fills
-        std::vector<bool> pending_fill_req(config_.num_banks, false);
         for (uint32_t bank_id = 0, n = config_.num_banks; bank_id < n; ++bank_id) {
             auto& mem_rsp_port = mem_rsp_ports_.at(bank_id);
+            bank_fills_.at(bank_id) = false;
             if (!mem_rsp_port.empty()) {
                 auto& mem_rsp = mem_rsp_port.front();
                 this->processMemoryFill(bank_id, mem_rsp.tag);                
-                pending_fill_req.at(bank_id) = true;
+                bank_fills_.at(bank_id) = true;
                 mem_rsp_port.pop();
             }
         }
@@ -356,6 +1101,7 @@ public:
                 continue;
 
             auto& core_req = core_req_port.front();
+            assert(!core_req.write || !config_.direct_fill);
 
             // check cache bypassing
             if (core_req.non_cacheable) {
@@ -371,20 +1117,10 @@ public:
             auto set_id  = params_.addr_set_id(core_req.addr);
             auto tag     = params_.addr_tag(core_req.addr);
             auto port_id = req_id % config_.ports_per_bank;
-            
-            // create bank request
-            bank_req_t bank_req(config_.ports_per_bank);
-            bank_req.valid = true;
-            bank_req.write = core_req.write;
-            bank_req.mshr_replay = false;
-            bank_req.tag = tag;            
-            bank_req.set_id = set_id;       
-            bank_req.core_id = core_req.core_id;
-            bank_req.uuid = core_req.uuid;
-            bank_req.infos.at(port_id) = {true, req_id, core_req.tag};
+            auto sectors = this->block_sectors(core_req);
 
             auto& bank = banks_.at(bank_id);            
-            auto& pipeline_req = pipeline_reqs.at(bank_id);
+            auto& pipeline_req = pipeline_reqs_.at(bank_id);
 
             // check pending MSHR replay
             if (pipeline_req.valid 
@@ -394,7 +1130,7 @@ public:
             }    
 
             // check pending fill request
-            if (pending_fill_req.at(bank_id)) {
+            if (bank_fills_.at(bank_id)) {
                 // stall
                 continue;
             }
@@ -414,34 +1150,115 @@ public:
                  || pipeline_req.tag != tag
                  || pipeline_req.infos[port_id].valid) {
                     ++perf_stats_.bank_stalls;
+                    ++bank_conflicts_.at(bank_id);
                     continue;
                 }
                 // update pending request infos
-                pipeline_req.infos[port_id] = bank_req.infos[port_id];
+                pipeline_req.infos[port_id] = {true, req_id, core_req.tag};
+                pipeline_req.sectors |= sectors;
             } else {
                 // schedule new request
-                pipeline_req = bank_req;
+                pipeline_req.valid = true;
+                pipeline_req.write = core_req.write;
+                pipeline_req.tag = tag;            
+                pipeline_req.set_id = set_id;       
+                pipeline_req.core_id = core_req.core_id;
+                pipeline_req.uuid = core_req.uuid;
+                pipeline_req.sectors = sectors;
+                pipeline_req.infos[port_id] = {true, req_id, core_req.tag};
             }
 
-            if (core_req.write)
+            if (core_req.write) {
                 ++perf_stats_.writes;
-            else
+            } else {
                 ++perf_stats_.reads;
+                prefetcher_.train(core_req.pc, core_req.addr, core_req.uuid);
+            }
 
             // remove request
             auto time = core_req_port.pop();
             perf_stats_.pipeline_stalls += (SimPlatform::instance().cycles() - time);
         }
     
+        // issue a prefetch into an idle bank
+        this->processPrefetch();
+
         // process active request        
-        this->processBankRequest(pipeline_reqs);
+        this->processBankRequest();
     } 
 
     const PerfStats& perf_stats() const {
         return perf_stats_;
     }
 
+    const std::vector<uint64_t>& bank_conflicts() const {
+        return bank_conflicts_;
+    }
+
+    void save(CheckpointWriter& writer) const {
+        writer.section("cache");
+        writer.write(flush_cycles_);
+        for (auto& bank : banks_) {
+            for (auto& set : bank.sets) {
+                writer.write(set.blocks);
+            }
+            bank.mshr.save(writer);
+            bank.victims.save(writer);
+        }
+        repl_policy_->save(writer);
+        writer.write(perf_stats_);
+        writer.write(bank_conflicts_);
+        writer.write(pending_read_reqs_);
+        writer.write(pending_write_reqs_);
+        writer.write(pending_fill_reqs_);
+    }
+
+    void restore(CheckpointReader& reader) {
+        reader.section("cache");
+        reader.read(&flush_cycles_);
+        for (auto& bank : banks_) {
+            for (auto& set : bank.sets) {
+                reader.expect<uint32_t>(set.blocks.size(), "cache geometry");
+                for (auto& block : set.blocks) {
+                    reader.read(&block);
+                }
+            }
+            bank.mshr.restore(reader);
+            bank.victims.restore(reader);
+        }
+        repl_policy_->restore(reader);
+        reader.read(&perf_stats_);
+        reader.read(&bank_conflicts_);
+        reader.read(&pending_read_reqs_);
+        reader.read(&pending_write_reqs_);
+        reader.read(&pending_fill_reqs_);
+    }
+
 private:
+
+    // sectors of the block accessed by a core request
+    uint64_t block_sectors(const MemReq& core_req) const {
+        if (0 == core_req.sector_mask)
+            return full_sectors_;
+        uint64_t block_addr = core_req.addr & ~((uint64_t(1) << config_.B) - 1);
+        uint64_t sectors = (core_req.sector_mask >> ((block_addr % MEM_BLOCK_SIZE) / MEM_SECTOR_SIZE)) & full_sectors_;
+        return sectors ? sectors : full_sectors_;
+    }
+
+    // sectors of the memory block for a block at addr
+    uint64_t mem_sectors(uint64_t addr, uint64_t sectors) const {
+        return sectors << ((addr % MEM_BLOCK_SIZE) / MEM_SECTOR_SIZE);
+    }
+
+    uint64_t sector_bytes(uint64_t sectors) const {
+        return std::bitset<64>(sectors).count() * sector_size_;
+    }
+
+    void markUsed(block_t& block, uint64_t sectors) {
+        uint64_t fresh = sectors & block.sectors & ~block.used;
+        block.used |= fresh;
+        perf_stats_.bytes_used += this->sector_bytes(fresh);
+    }
     
     void processIORequest(const MemReq& core_req, uint32_t req_id) {
         {
@@ -458,20 +1275,110 @@ private:
         }
     }
 
+    void processPrefetch() {
+        while (!prefetcher_.empty()) {
+            auto addr    = prefetcher_.front();
+            auto bank_id = params_.addr_bank_id(addr);
+            auto& bank   = banks_.at(bank_id);
+
+            // demand requests go first, and keep an MSHR slot for them
+            auto& pipeline_req = pipeline_reqs_.at(bank_id);
+            if (pipeline_req.valid
+             || bank_fills_.at(bank_id)
+             || bank.mshr.available() < 2)
+                return;
+
+            prefetcher_.pop();
+
+            // drop lines already cached or in flight
+            auto set_id = params_.addr_set_id(addr);
+            auto tag    = params_.addr_tag(addr);
+            if (bank.sets.at(set_id).contains(tag)
+             || bank.victims.contains(set_id, tag)
+             || bank.mshr.lookup(set_id, tag) != -1)
+                continue;
+
+            pipeline_req.valid = true;
+            pipeline_req.write = false;
+            pipeline_req.prefetch = true;
+            pipeline_req.tag = tag;
+            pipeline_req.set_id = set_id;
+            pipeline_req.core_id = 0;
+            pipeline_req.uuid = 0;
+            pipeline_req.sectors = full_sectors_;
+            return;
+        }
+    }
+
     void processMemoryFill(uint32_t bank_id, uint32_t mshr_id) {
+        if (config_.direct_fill) {
+            this->processDirectFill(bank_id, mshr_id);
+            return;
+        }
         // update block
         auto& bank  = banks_.at(bank_id);
         auto& entry = bank.mshr.replay(mshr_id);
-        auto& set   = bank.sets.at(entry.set_id);
-        auto& block = set.blocks.at(entry.block_id);
+        this->installBlock(bank_id, entry);
+        --pending_fill_reqs_;
+    }
+
+    void installBlock(uint32_t bank_id, const mshr_entry_t& entry) {
+        auto& bank  = banks_.at(bank_id);
+        auto& block = bank.sets.at(entry.set_id).blocks.at(entry.block_id);
+        if (block.valid && block.tag == entry.tag) {
+            // sectors filled into a resident block
+            block.sectors |= entry.fill;
+            return;
+        }
+        if (block.valid && bank.victims.enabled()) {
+            // keep the evicted block in the victim cache
+            block_t evicted;
+            if (bank.victims.insert(entry.set_id, block, &evicted) 
+             && evicted.dirty) {
+                MemReq mem_req;
+                mem_req.addr  = params_.mem_addr(bank_id, entry.set_id, evicted.tag);
+                mem_req.write = true;
+                mem_req.core_id = entry.core_id;
+                mem_req_ports_.at(bank_id).send(mem_req, 1);
+                DT(3, simobject_->name() << "-" << mem_req);
+                ++perf_stats_.evictions;
+            }
+            ++perf_stats_.victim_fills;
+        }
         block.valid = true;
+        block.dirty = false;
+        block.prefetched = entry.prefetch;
         block.tag   = entry.tag;
+        block.sectors = entry.fill;
+        block.used  = 0;
+        repl_policy_->fill(bank_id * params_.sets_per_bank + entry.set_id, entry.block_id);
+    }
+
+    // read-only caches have no dirty blocks and may answer the waiting
+    // requests with the fill instead of replaying them through the bank
+    void processDirectFill(uint32_t bank_id, uint32_t mshr_id) {
+        auto& bank  = banks_.at(bank_id);
+        auto& entry = bank.mshr.at(mshr_id);
+        this->installBlock(bank_id, entry);
+        auto& block = bank.sets.at(entry.set_id).blocks.at(entry.block_id);
+        bank.mshr.retire(mshr_id, [&](const mshr_entry_t& waiting) {
+            if (!waiting.prefetch) {
+                this->markUsed(block, waiting.sectors);
+            }
+            for (auto& info : waiting.infos) {
+                if (!info.valid)
+                    continue;
+                MemRsp core_rsp{info.req_tag, waiting.core_id, waiting.uuid};
+                simobject_->CoreRspPorts.at(info.req_id).send(core_rsp, 1);
+                DT(3, simobject_->name() << "-fill-" << core_rsp);
+            }
+        });
         --pending_fill_reqs_;
     }
 
-    void processBankRequest(const std::vector<bank_req_t>& pipeline_reqs) {
+    void processBankRequest() {
         for (uint32_t bank_id = 0, n = config_.num_banks; bank_id < n; ++bank_id) {
-            auto& pipeline_req = pipeline_reqs.at(bank_id);
+            auto& pipeline_req = pipeline_reqs_.at(bank_id);
             if (!pipeline_req.valid)
                 continue;
 
@@ -479,32 +1386,34 @@ private:
             auto& set = bank.sets.at(pipeline_req.set_id);
 
             if (pipeline_req.mshr_replay) {
+                if (!pipeline_req.write && !pipeline_req.prefetch) {
+                    for (auto& block : set.blocks) {
+                        if (block.valid && block.tag == pipeline_req.tag) {
+                            this->markUsed(block, pipeline_req.sectors);
+                        }
+                    }
+                }
                 // send core response
                 for (auto& info : pipeline_req.infos) {
+                    if (!info.valid)
+                        continue;
                     MemRsp core_rsp{info.req_tag, pipeline_req.core_id, pipeline_req.uuid};
                     simobject_->CoreRspPorts.at(info.req_id).send(core_rsp, config_.latency);  
                     DT(3, simobject_->name() << "-" << core_rsp);         
                 }
             } else {        
-                bool hit = false;
+                bool tag_hit = false;
                 bool found_free_block = false;            
                 uint32_t hit_block_id = 0;
                 uint32_t repl_block_id = 0;            
-                uint32_t max_cnt = 0;
+                auto repl_set_id = bank_id * params_.sets_per_bank + pipeline_req.set_id;
                 
                 for (uint32_t i = 0, n = set.blocks.size(); i < n; ++i) {
                     auto& block = set.blocks.at(i);
                     if (block.valid) {
                         if (block.tag == pipeline_req.tag) {
-                            block.lru_ctr = 0;                        
                             hit_block_id = i;
-                            hit = true;
-                        } else {
-                            ++block.lru_ctr;
-                        }
-                        if (max_cnt < block.lru_ctr) {
-                            max_cnt = block.lru_ctr;
-                            repl_block_id = i;
+                            tag_hit = true;
                         }
                     } else {                    
                         found_free_block = true;
@@ -512,13 +1421,47 @@ private:
                     }
                 }
 
+                // select the block to replace
+                if (!tag_hit 
+                 && !found_free_block
+                 && (!pipeline_req.write || !config_.write_through)) {
+                    repl_block_id = repl_policy_->victim(repl_set_id);
+                }
+
+                // check the victim cache, write-through writes do not allocate
+                uint32_t latency = config_.latency;
+                if (!tag_hit 
+                 && (!pipeline_req.write || !config_.write_through)
+                 && bank.victims.swap(pipeline_req.set_id, pipeline_req.tag, &set.blocks.at(repl_block_id))) {
+                    hit_block_id = repl_block_id;
+                    tag_hit = true;
+                    latency += config_.victim_latency;
+                    ++perf_stats_.victim_hits;
+                    if (!pipeline_req.write) {
+                        ++perf_stats_.victim_read_hits;
+                    }
+                }
+
+                // a sector miss keeps the block and fetches its missing sectors
+                uint64_t valid_sectors = tag_hit ? set.blocks.at(hit_block_id).sectors : 0;
+                bool hit = tag_hit && ((valid_sectors & pipeline_req.sectors) == pipeline_req.sectors);
+                bool sector_miss = tag_hit && !hit;
+                if (sector_miss) {
+                    repl_block_id = hit_block_id;
+                }
+
                 if (hit) {     
                     //
                     // Hit handling   
                     //                
+                    auto& hit_block = set.blocks.at(hit_block_id);
+                    repl_policy_->touch(repl_set_id, hit_block_id);
+                    if (hit_block.prefetched) {
+                        hit_block.prefetched = false;
+                        ++perf_stats_.prefetch_hits;
+                    }
                     if (pipeline_req.write) {
                         // handle write hit
-                        auto& hit_block = set.blocks.at(hit_block_id);
                         if (config_.write_through) {
                             // forward write request to memory
                             MemReq mem_req;
@@ -526,18 +1469,23 @@ private:
                             mem_req.write = true;
                             mem_req.core_id = pipeline_req.core_id;
                             mem_req.uuid = pipeline_req.uuid;
+                            mem_req.sector_mask = this->mem_sectors(mem_req.addr, pipeline_req.sectors);
                             mem_req_ports_.at(bank_id).send(mem_req, 1);
                             DT(3, simobject_->name() << "-" << mem_req);
                         } else {
                             // mark block as dirty
                             hit_block.dirty = true;
                         }
+                    } else {
+                        this->markUsed(hit_block, pipeline_req.sectors);
                     }
                     // send core response
                     if (!pipeline_req.write || config_.write_reponse) {
                         for (auto& info : pipeline_req.infos) {     
+                            if (!info.valid)
+                                continue;
                             MemRsp core_rsp{info.req_tag, pipeline_req.core_id, pipeline_req.uuid};
-                            simobject_->CoreRspPorts.at(info.req_id).send(core_rsp, config_.latency);
+                            simobject_->CoreRspPorts.at(info.req_id).send(core_rsp, latency);
                             DT(3, simobject_->name() << "-" << core_rsp);
                         }
                     }
@@ -547,10 +1495,12 @@ private:
                     //
                     if (pipeline_req.write)
                         ++perf_stats_.write_misses;
+                    else if (pipeline_req.prefetch)
+                        ++perf_stats_.prefetches;
                     else
                         ++perf_stats_.read_misses;
 
-                    if (!found_free_block && !config_.write_through) {
+                    if (!found_free_block && !sector_miss && !config_.write_through && !bank.victims.enabled()) {
                         // write back dirty block
                         auto& repl_block = set.blocks.at(repl_block_id);
                         if (repl_block.dirty) {                       
@@ -572,23 +1522,35 @@ private:
                             mem_req.write = true;
                             mem_req.core_id = pipeline_req.core_id;
                             mem_req.uuid = pipeline_req.uuid;
+                            mem_req.sector_mask = this->mem_sectors(mem_req.addr, pipeline_req.sectors);
                             mem_req_ports_.at(bank_id).send(mem_req, 1);
                             DT(3, simobject_->name() << "-" << mem_req);
                         }
                         // send core response
                         if (config_.write_reponse) {
                             for (auto& info : pipeline_req.infos) {         
+                                if (!info.valid)
+                                    continue;
                                 MemRsp core_rsp{info.req_tag, pipeline_req.core_id, pipeline_req.uuid};
                                 simobject_->CoreRspPorts.at(info.req_id).send(core_rsp, config_.latency);
                                 DT(3, simobject_->name() << "-" << core_rsp);
                             }
                         }
                     } else {
-                        // MSHR lookup
-                        int pending = bank.mshr.lookup(pipeline_req);
+                        // sectors to fetch, the whole block if not sectored
+                        uint64_t fill_sectors = config_.sectored ? (pipeline_req.sectors & ~valid_sectors) : full_sectors_;
+
+                        // MSHR lookup of a fill in flight with these sectors
+                        int pending = bank.mshr.lookup(pipeline_req.set_id, pipeline_req.tag, fill_sectors);
+
+                        // a demand miss on a prefetch in flight
+                        if (pending != -1 && bank.mshr.at(pending).prefetch) {
+                            bank.mshr.at(pending).prefetch = false;
+                            ++perf_stats_.prefetch_hits;
+                        }
 
                         // allocate MSHR
-                        int mshr_id = bank.mshr.allocate(pipeline_req, repl_block_id);
+                        int mshr_id = bank.mshr.allocate(pipeline_req, repl_block_id, pending, fill_sectors);
                         
                         // send fill request
                         if (pending == -1) {
@@ -598,8 +1560,10 @@ private:
                             mem_req.tag   = mshr_id;
                             mem_req.core_id = pipeline_req.core_id;
                             mem_req.uuid = pipeline_req.uuid;
+                            mem_req.sector_mask = this->mem_sectors(mem_req.addr, fill_sectors);
                             mem_req_ports_.at(bank_id).send(mem_req, 1);
                             DT(3, simobject_->name() << "-" << mem_req);
+                            perf_stats_.bytes_fetched += this->sector_bytes(fill_sectors);
                             ++pending_fill_reqs_;
                         }
                     }
@@ -613,7 +1577,7 @@ private:
 
 Cache::Cache(const SimContext& ctx, const char* name, const Config& config) 
     : SimObject<Cache>(ctx, name)    
-    , CoreReqPorts(config.num_inputs, this)
+    , CoreReqPorts(config.num_inputs, SimPort<MemReq>(this, config.creq_size))
     , CoreRspPorts(config.num_inputs, this)
     , MemReqPort(this)
     , MemRspPort(this)
@@ -628,10 +1592,26 @@ void Cache::reset() {
     impl_->reset();
 }
 
+bool Cache::idle() const {
+    return impl_->idle();
+}
+
 void Cache::tick() {
     impl_->tick();
 }
 
 const Cache::PerfStats& Cache::perf_stats() const {
     return impl_->perf_stats();
+}
+
+const std::vector<uint64_t>& Cache::bank_conflicts() const {
+    return impl_->bank_conflicts();
+}
+
+void Cache::save(CheckpointWriter& writer) const {
+    impl_->save(writer);
+}
+
+void Cache::restore(CheckpointReader& reader) {
+    impl_->restore(reader);
 }
\ No newline at end of file
@@ -3,8 +3,19 @@
 #include <simobject.h>
 #include "memsim.h"
 
+class CheckpointWriter;
+class CheckpointReader;
+
 namespace vortex {
 
+enum class ReplPolicy {
+    LRU,    // least recently used
+    PLRU,   // tree pseudo-LRU
+    SRRIP,  // static re-reference interval prediction
+    BRRIP,  // bimodal re-reference interval prediction
+    RANDOM, // pseudo-random
+};
+
 class Cache : public SimObject<Cache> {
 public:
     struct Config {
@@ -19,8 +30,18 @@ public:
         bool    write_through;  // is write-through
         bool    write_reponse;  // enable write response
         uint16_t victim_size;   // victim cache size
+        uint8_t victim_latency; // extra latency of victim cache hits
         uint16_t mshr_size;     // MSHR buffer size
         uint8_t latency;        // pipeline latency
+        uint8_t creq_size;      // core request queue size (0: unbounded)
+        uint16_t prefetch_size; // stride prefetcher table size (0: disabled)
+        uint8_t prefetch_degree;// lines prefetched ahead of a trained stream
+        uint8_t next_lines;     // next-line prefetch depth (0: disabled)
+        bool    direct_fill;    // fills answer waiting reads directly (no writes)
+        ReplPolicy repl_policy; // replacement policy
+        IndexHash bank_hash;    // bank selection hash
+        IndexHash set_hash;     // set selection hash
+        bool    sectored;       // fills fetch the missing MEM_SECTOR_SIZE sectors only
     };
     
     struct PerfStats {
@@ -33,6 +54,13 @@ public:
         uint64_t bank_stalls;
         uint64_t mshr_stalls;
         uint64_t mem_latency;
+        uint64_t prefetches;
+        uint64_t prefetch_hits;
+        uint64_t victim_fills;
+        uint64_t victim_hits;
+        uint64_t victim_read_hits;
+        uint64_t bytes_fetched;
+        uint64_t bytes_used;
 
         PerfStats() 
             : reads(0)
@@ -44,6 +72,13 @@ public:
             , bank_stalls(0)
             , mshr_stalls(0)
             , mem_latency(0)
+            , prefetches(0)
+            , prefetch_hits(0)
+            , victim_fills(0)
+            , victim_hits(0)
+            , victim_read_hits(0)
+            , bytes_fetched(0)
+            , bytes_used(0)
         {}
     };
 
@@ -56,10 +91,19 @@ public:
     ~Cache();
 
     void reset();
+
+    bool idle() const;
     
     void tick();
 
     const PerfStats& perf_stats() const;
+
+    // bank stalls of each bank
+    const std::vector<uint64_t>& bank_conflicts() const;
+
+    void save(CheckpointWriter& writer) const;
+
+    void restore(CheckpointReader& reader);
     
 private:
     class Impl;
@@ -12,6 +12,10 @@
 #define MEMORY_BANKS 2
 #endif
 
+#ifndef L1_QUEUE_SIZE
+#define L1_QUEUE_SIZE 4
+#endif
+
 namespace vortex {
 
 enum Constants {
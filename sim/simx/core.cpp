@@ -10,6 +10,7 @@
 #include "core.h"
 #include "debug.h"
 #include "constants.h"
+#include <checkpoint.h>
 
 using namespace vortex;
 
@@ -20,6 +21,8 @@ Core::Core(const SimContext& ctx, const ArchDef &arch, uint32_t id)
     , id_(id)
     , arch_(arch)
     , decoder_(arch)
+    , code_version_(0)
+    , ram_(nullptr)
     , mmu_(0, arch.wsize())
     , smem_(RAM_PAGE_SIZE)
     , tex_units_(NUM_TEX_UNITS, this)
@@ -28,7 +31,12 @@ Core::Core(const SimContext& ctx, const ArchDef &arch, uint32_t id)
     , csrs_(arch.num_csrs(), 0)
     , fcsrs_(arch.num_warps(), 0)
     , ibuffers_(arch.num_warps(), IBUF_SIZE)
+    , redirect_cycles_(arch.num_warps(), 0)
+    , wrong_path_pcs_(arch.num_warps(), 0)
+    , squash_epochs_(arch.num_warps(), 0)
     , scoreboard_(arch_) 
+    , scheduler_(arch_)
+    , predictor_(arch_, BTB_SIZE)
     , exe_units_((int)ExeType::MAX)
     , rbt_mem_(RbtMem::Create("rbtmem", 5)) 
     , bcu_(BcuUnit::Create(this, "bcu"))
@@ -39,13 +47,23 @@ Core::Core(const SimContext& ctx, const ArchDef &arch, uint32_t id)
         0,                      // A
         32,                     // address bits    
         1,                      // number of banks
-        1,                      // number of ports
-        1,                      // request size   
+        ISSUE_WIDTH,            // number of ports
+        ISSUE_WIDTH,            // request size   
         true,                   // write-through
         false,                  // write response
         0,                      // victim size
+        0,                      // victim latency
         NUM_WARPS,              // mshr
         2,                      // pipeline latency
+        L1_QUEUE_SIZE,          // request queue size
+        0,                      // prefetch table size
+        0,                      // prefetch degree
+        ICACHE_PREFETCH_LINES,  // next-line prefetch
+        ICACHE_DIRECT_FILL,     // direct fill
+        ReplPolicy::LRU,        // replacement policy
+        IndexHash::None,        // bank hash
+        IndexHash::None,        // set hash
+        false,                  // sectored
       }))
     , dcache_(Cache::Create("dcache", Cache::Config{
         log2ceil(DCACHE_SIZE),  // C
@@ -58,21 +76,33 @@ Core::Core(const SimContext& ctx, const ArchDef &arch, uint32_t id)
         (uint8_t)arch.num_threads(), // request size   
         true,                   // write-through
         false,                  // write response
-        0,                      // victim size
+        DCACHE_VICTIM_SIZE,     // victim size
+        DCACHE_VICTIM_LATENCY,  // victim latency
         DCACHE_MSHR_SIZE,       // mshr
         4,                      // pipeline latency
+        L1_QUEUE_SIZE,          // request queue size
+        DCACHE_PREFETCH_SIZE,   // prefetch table size
+        DCACHE_PREFETCH_DEGREE, // prefetch degree
+        0,                      // next-line prefetch
+        false,                  // direct fill
+        ReplPolicy::LRU,        // replacement policy
+        (IndexHash)DCACHE_BANK_HASH, // bank hash
+        (IndexHash)DCACHE_SET_HASH,  // set hash
+        DCACHE_SECTORED,        // sectored
       }))
     , shared_mem_(SharedMem::Create("sharedmem", SharedMem::Config{
         arch.num_threads(), 
         arch.num_threads(), 
         Constants::SMEM_BANK_OFFSET,
         1,
-        false
+        false,
+        (IndexHash)SMEM_BANK_HASH
       }))
     , l1_mem_switch_(Switch<MemReq, MemRsp>::Create("l1_arb", ArbiterType::Priority, 2)) 
     , dcache_switch_(arch.num_threads())
     , fetch_latch_("fetch")
     , decode_latch_("decode")
+    , trace_pool_(arch_)
     , pending_icache_(arch_.num_warps())
 {  
   for (uint32_t i = 0; i < arch_.num_warps(); ++i) {
@@ -104,23 +134,30 @@ Core::Core(const SimContext& ctx, const ArchDef &arch, uint32_t id)
   for (uint32_t i = 0, n = arch.num_threads(); i < n; ++i) {
     auto& sw = dcache_switch_.at(i);
 #ifdef EXT_TEX_ENABLE
-    sw = Switch<MemReq, MemRsp>::Create("lsu_arb", ArbiterType::Priority, 2);
+    sw = Switch<MemReq, MemRsp>::Create("lsu_arb", ArbiterType::Priority, 2, 1, L1_QUEUE_SIZE);
 #else
-    sw = Switch<MemReq, MemRsp>::Create("lsu_arb", ArbiterType::Priority, 1);
+    sw = Switch<MemReq, MemRsp>::Create("lsu_arb", ArbiterType::Priority, 1, 1, L1_QUEUE_SIZE);
 #endif        
     sw->ReqOut.bind(&dcache_->CoreReqPorts.at(i));
     dcache_->CoreRspPorts.at(i).bind(&sw->RspIn);
   } 
 
+  // publish staged stores once every core has ticked
+  SimPlatform::instance().on_cycle_end([this]() {
+    this->publish_writes();
+  });
+
   // memory perf callbacks
   MemReqPort.tx_callback([&](const MemReq& req, uint64_t cycle){
     __unused (cycle);
     perf_stats_.mem_reads   += !req.write;
     perf_stats_.mem_writes  += req.write;
+    this->update_mem_latency();
     perf_mem_pending_reads_ += !req.write;    
   });
   MemRspPort.tx_callback([&](const MemRsp&, uint64_t cycle){
     __unused (cycle);
+    this->update_mem_latency();
     --perf_mem_pending_reads_;
   });
 
@@ -163,19 +200,100 @@ void Core::reset() {
   decode_latch_.clear();
   pending_icache_.clear();  
   stalled_warps_.reset();  
-  last_schedule_wid_ = 0;
+  for (auto& cycle : redirect_cycles_) {
+    cycle = 0;
+  }
+  pending_redirects_ = 0;
+  wrong_path_warps_.reset();
+  for (auto& epoch : squash_epochs_) {
+    epoch = 0;
+  }
+  wrong_path_traces_ = 0;
+  scheduler_.clear();
+  predictor_.clear();
   issued_instrs_ = 0;
   committed_instrs_ = 0;
   csr_tex_unit_ = 0;
   ecall_ = false;
   ebreak_ = false;
+  draining_ = false;
+  functional_ = false;
+  decode_cache_.clear();
+  block_cache_.clear();
+  pending_writes_.clear();
   perf_mem_pending_reads_ = 0;
+  perf_mem_latency_cycle_ = SimPlatform::instance().cycles();
+  perf_skip_cycle_ = SimPlatform::instance().cycles();
   perf_stats_ = PerfStats();
+  this->update_skip_stalls();
+}
+
+bool Core::idle() const {
+  // a core is idle when no warp can be scheduled and its pipeline is
+  // either drained or waiting on results still in flight; pending
+  // responses will wake it up.
+  if (!draining_ && (active_warps_ & ~stalled_warps_).any())
+    return false;
+  // the scheduler has to observe changes to the active warps
+  if (!draining_ && active_warps_ != scheduler_.active_warps())
+    return false;
+  if (pending_redirects_ != 0)
+    return false;
+  if (!fetch_latch_.empty())
+    return false;
+  for (auto& icache_rsp_port : icache_->CoreRspPorts) {
+    if (!icache_rsp_port.empty())
+      return false;
+  }
+  for (auto& exe_unit : exe_units_) {
+    if (!exe_unit->Output.empty())
+      return false;
+  }
+  if (!decode_latch_.empty() 
+   && !ibuffers_.at(decode_latch_.front()->wid).full())
+    return false;
+  for (auto& ibuf : ibuffers_) {
+    if (!ibuf.empty() && !scoreboard_.in_use(ibuf.top()))
+      return false;
+  }
+  return true;
+}
+
+void Core::update_mem_latency() const {
+  // accumulate outstanding reads lazily so that skipped cycles are counted
+  auto cycle = SimPlatform::instance().cycles();
+  perf_stats_.mem_latency += perf_mem_pending_reads_ * (cycle - perf_mem_latency_cycle_);
+  perf_mem_latency_cycle_ = cycle;
+}
+
+void Core::update_skip_stalls() {
+  // what a tick would count while the core stays idle
+  bool scheduling = !draining_;
+  skip_stalls_.sched_idles = scheduling && active_warps_.none();
+  skip_stalls_.sched_stalls = scheduling && active_warps_.any();
+  skip_stalls_.ibuf_stalls = !decode_latch_.empty();
+  skip_stalls_.scrb_stalls = 0;
+  for (auto& ibuf : ibuffers_) {
+    skip_stalls_.scrb_stalls += !ibuf.empty();
+  }
+}
+
+void Core::update_skipped_cycles() const {
+  // accumulate the stalls of skipped cycles lazily, like mem_latency
+  auto cycle = SimPlatform::instance().cycles();
+  if (cycle <= perf_skip_cycle_)
+    return;
+  uint64_t skipped = cycle - perf_skip_cycle_;
+  scheduler_.skip(skip_stalls_.sched_idles * skipped, skip_stalls_.sched_stalls * skipped);
+  perf_stats_.ibuf_stalls += skip_stalls_.ibuf_stalls * skipped;
+  perf_stats_.scrb_stalls += skip_stalls_.scrb_stalls * skipped;
+  perf_skip_cycle_ = cycle;
 }
 
 void Core::attach_ram(RAM* ram) {
   // bind RAM to memory unit
   mmu_.attach(*ram, 0, 0xFFFFFFFF);    
+  ram_ = ram;
 }
 
 void Core::cout_flush() {
@@ -188,131 +306,315 @@ void Core::cout_flush() {
 }
 
 void Core::tick() {
+  this->update_skipped_cycles();
+
   this->commit();
   this->execute();
   this->decode();
   this->fetch();
+  this->update_redirects();
   this->schedule();
 
-  // update perf counter  
-  perf_stats_.mem_latency += perf_mem_pending_reads_;
+  this->update_skip_stalls();
+  perf_skip_cycle_ = SimPlatform::instance().cycles() + 1;
 
   DPN(2, std::flush);
 }
 
+void Core::redirect_warp(uint32_t wid, uint32_t penalty) {
+  if (0 == penalty) {
+    stalled_warps_.reset(wid);
+    return;
+  }
+  stalled_warps_.set(wid);
+  redirect_cycles_.at(wid) = SimPlatform::instance().cycles() + penalty;
+  ++pending_redirects_;
+}
+
+void Core::update_redirects() {
+  if (0 == pending_redirects_)
+    return;
+  auto cycle = SimPlatform::instance().cycles();
+  for (uint32_t wid = 0, nw = arch_.num_warps(); wid < nw; ++wid) {
+    auto& redirect_cycle = redirect_cycles_.at(wid);
+    if (redirect_cycle != 0 && redirect_cycle <= cycle) {
+      DT(3, "pipeline-redirect: coreid=" << id_ << ", wid=" << wid);
+      stalled_warps_.reset(wid);
+      redirect_cycle = 0;
+      --pending_redirects_;
+    }
+  }
+}
+
+void Core::fetch_wrong_path(uint32_t wid) {
+  // wrong-path instructions only occupy the front-end, they are never
+  // executed and are dropped once the branch resolves
+  auto trace = trace_pool_.allocate((issued_instrs_ * arch_.num_cores()) + id_);
+  auto& pc = wrong_path_pcs_.at(wid);
+  trace->cid = id_;
+  trace->wid = wid;
+  trace->PC = pc;
+  trace->wrong_path = true;
+  trace->squash_epoch = squash_epochs_.at(wid);
+  pc += 4;
+  ++wrong_path_traces_;
+  ++perf_stats_.wrong_path_fetches;
+
+  DT(3, "pipeline-schedule: " << *trace);
+
+  fetch_latch_.push(trace);
+}
+
+void Core::squash_warp(uint32_t wid) {
+  // the ibuffer only holds instructions fetched after the branch, those
+  // still in fetch or decode are dropped when they reach the stage front
+  wrong_path_warps_.reset(wid);
+  ++squash_epochs_.at(wid);
+  auto& ibuffer = ibuffers_.at(wid);
+  while (!ibuffer.empty()) {
+    auto trace = ibuffer.top();
+    assert(trace->wrong_path);
+    ibuffer.pop();
+    this->release_wrong_path(trace);
+  }
+  DT(3, "pipeline-squash: coreid=" << id_ << ", wid=" << wid);
+  this->redirect_warp(wid, BRANCH_MISPREDICT_PENALTY);
+}
+
+void Core::release_wrong_path(pipeline_trace_t* trace) {
+  assert(wrong_path_traces_ != 0);
+  --wrong_path_traces_;
+  trace_pool_.release(trace);
+}
+
 void Core::schedule() {
-  bool foundSchedule = false;
-  uint32_t scheduled_warp = last_schedule_wid_;
-
-  // round robin scheduling
-  for (size_t wid = 0, nw = arch_.num_warps(); wid < nw; ++wid) {    
-    scheduled_warp = (scheduled_warp + 1) % nw;
-    bool warp_active = active_warps_.test(scheduled_warp);
-    bool warp_stalled = stalled_warps_.test(scheduled_warp); 
-    if (warp_active && !warp_stalled) {      
-      last_schedule_wid_ = scheduled_warp;
-      foundSchedule = true;
+  if (draining_)
+    return;
+
+  // schedule up to ISSUE_WIDTH different warps per cycle, the scheduler
+  // counts a stall for the first slot left empty
+  for (uint32_t slot = 0; slot < ISSUE_WIDTH; ++slot) {
+    int scheduled_warp = scheduler_.select(active_warps_, stalled_warps_);
+    if (scheduled_warp < 0)
       break;
+
+    // suspend warp until decode
+    stalled_warps_.set(scheduled_warp);
+
+    if (wrong_path_warps_.test(scheduled_warp)) {
+      this->fetch_wrong_path(scheduled_warp);
+      continue;
     }
-  }
 
-  if (!foundSchedule)
-    return;  
+    uint64_t uuid = (issued_instrs_++ * arch_.num_cores()) + id_;
+
+    auto trace = trace_pool_.allocate(uuid);
 
-  // suspend warp until decode
-  stalled_warps_.set(scheduled_warp);
+    auto& warp = warps_.at(scheduled_warp);
+    warp->eval(trace);
 
-  uint64_t uuid = (issued_instrs_++ * arch_.num_cores()) + id_;
+    // keep fetching past control instructions from the predicted PC
+    Word predicted_pc = 0;
+    if (trace->fetch_stall
+     && trace->exe_type == ExeType::ALU
+     && trace->alu.type == AluType::BRANCH
+     && predictor_.predict(scheduled_warp, trace->PC, warp->getPC(), &predicted_pc)) {
+      trace->fetch_stall = false;
+      if (predicted_pc != warp->getPC()) {
+        trace->mispredicted = true;
+        wrong_path_warps_.set(scheduled_warp);
+        wrong_path_pcs_.at(scheduled_warp) = predicted_pc;
+      }
+    }
 
-  auto trace = new pipeline_trace_t(uuid, arch_);
+    DT(3, "pipeline-schedule: " << *trace);
 
-  auto& warp = warps_.at(scheduled_warp);
-  warp->eval(trace);
+    // advance to fetch stage  
+    fetch_latch_.push(trace);
+  }
+}
 
-  DT(3, "pipeline-schedule: " << *trace);
+uint64_t Core::step_functional(uint32_t quantum) {
+  assert(functional_);
+  pipeline_trace_t trace(0, arch_);
+  uint64_t executed = 0;
+
+  for (uint32_t wid = 0, nw = arch_.num_warps(); wid < nw; ++wid) {
+    auto& warp = warps_.at(wid);
+    for (uint32_t i = 0; i < quantum; ++i) {
+      if (!active_warps_.test(wid) || this->check_exit())
+        break;
+
+      // straight-line code runs as a translated block when it fits the quantum
+      auto block = this->get_block(warp->getPC());
+      if (block && !block->empty() && block->size() <= (quantum - i)) {
+        auto active_threads = warp->getActiveThreads();
+        auto count = warp->execute_block(*block);
+        issued_instrs_ += count;
+        committed_instrs_ += count;
+        perf_stats_.instrs += count * active_threads;
+        executed += count;
+        i += count - 1;
+        continue;
+      }
 
-  // advance to fetch stage  
-  fetch_latch_.push(trace);
+      uint64_t uuid = (issued_instrs_++ * arch_.num_cores()) + id_;
+      trace.reset(uuid);
+      warp->eval(&trace);
+
+      // apply the warp control updates of the GPU unit
+      if (trace.exe_type == ExeType::GPU) {
+        switch (trace.gpu.type) {
+        case GpuType::TMC:
+          active_warps_.set(wid, trace.gpu.active_warps.test(wid));
+          break;
+        case GpuType::WSPAWN:
+          active_warps_ = trace.gpu.active_warps;
+          break;
+        case GpuType::BAR:
+          if (trace.gpu.active_warps != 0)
+            active_warps_ |= trace.gpu.active_warps;
+          else
+            active_warps_.reset(wid);
+          break;
+        default:
+          break;
+        }
+      }
+
+      ++committed_instrs_;
+      perf_stats_.instrs += trace.tmask.count();
+      ++executed;
+    }
+  }
+
+  return executed;
 }
 
 void Core::fetch() {
-  // handle icache reponse
-  auto& icache_rsp_port = icache_->CoreRspPorts.at(0);      
-  if (!icache_rsp_port.empty()){
+  // handle icache reponses
+  for (auto& icache_rsp_port : icache_->CoreRspPorts) {
+    if (icache_rsp_port.empty())
+      continue;
     auto& mem_rsp = icache_rsp_port.front();
     auto trace = pending_icache_.at(mem_rsp.tag);
-    decode_latch_.push(trace);
     DT(3, "icache-rsp: addr=" << std::hex << trace->PC << ", tag=" << mem_rsp.tag << ", " << *trace);
+    if (this->is_squashed(trace)) {
+      this->release_wrong_path(trace);
+    } else {
+      decode_latch_.push(trace);
+    }
     pending_icache_.release(mem_rsp.tag);
     icache_rsp_port.pop();
   }
 
-  // send icache request
-  if (!fetch_latch_.empty()) {
+  // send up to ISSUE_WIDTH icache requests, one per port
+  for (auto& icache_req_port : icache_->CoreReqPorts) {
+    // drop squashed wrong-path instructions
+    while (!fetch_latch_.empty() && this->is_squashed(fetch_latch_.front())) {
+      this->release_wrong_path(fetch_latch_.front());
+      fetch_latch_.pop();
+    }
+
+    if (fetch_latch_.empty())
+      break;
+
     auto trace = fetch_latch_.front();
+    if (icache_req_port.full()) {
+      if (!trace->suspend()) {
+        DT(3, "*** icache-stall: " << *trace);
+      }
+      break;
+    } else {
+      trace->resume();
+    }
     MemReq mem_req;
     mem_req.addr  = trace->PC;
     mem_req.write = false;
     mem_req.tag   = pending_icache_.allocate(trace);    
     mem_req.core_id = trace->cid;
     mem_req.uuid = trace->uuid;
-    icache_->CoreReqPorts.at(0).send(mem_req, 1);    
+    mem_req.sector_mask = sector_mask(trace->PC, sizeof(uint32_t));
+    icache_req_port.send(mem_req, 1);    
     DT(3, "icache-req: addr=" << std::hex << mem_req.addr << ", tag=" << mem_req.tag << ", " << *trace);
     fetch_latch_.pop();
   }    
 }
 
 void Core::decode() {
-  if (decode_latch_.empty())
-    return;
+  // decode up to ISSUE_WIDTH instructions in fetch order
+  for (uint32_t slot = 0; slot < ISSUE_WIDTH; ++slot) {
+    // drop squashed wrong-path instructions
+    while (!decode_latch_.empty() && this->is_squashed(decode_latch_.front())) {
+      this->release_wrong_path(decode_latch_.front());
+      decode_latch_.pop();
+    }
+
+    if (decode_latch_.empty())
+      return;
 
-  auto trace = decode_latch_.front();
+    auto trace = decode_latch_.front();
 
-  // check ibuffer capacity
-  auto& ibuffer = ibuffers_.at(trace->wid);
-  if (ibuffer.full()) {
-    if (!trace->suspend()) {
-      DT(3, "*** ibuffer-stall: " << *trace);
+    // check ibuffer capacity
+    auto& ibuffer = ibuffers_.at(trace->wid);
+    if (ibuffer.full()) {
+      if (!trace->suspend()) {
+        DT(3, "*** ibuffer-stall: " << *trace);
+      }
+      ++perf_stats_.ibuf_stalls;
+      return;
+    } else {
+      trace->resume();
+    }
+    
+    // release warp
+    if (!trace->fetch_stall) {
+      stalled_warps_.reset(trace->wid);
     }
-    ++perf_stats_.ibuf_stalls;
-    return;
-  } else {
-    trace->resume();
-  }
-  
-  // release warp
-  if (!trace->fetch_stall) {
-    stalled_warps_.reset(trace->wid);
-  }
 
-  // update perf counters
-  uint32_t active_threads = trace->tmask.count();
-  if (trace->exe_type == ExeType::LSU && trace->lsu.type == LsuType::LOAD)
-    perf_stats_.loads += active_threads;
-  if (trace->exe_type == ExeType::LSU && trace->lsu.type == LsuType::STORE) 
-    perf_stats_.stores += active_threads;
-  if (trace->exe_type == ExeType::ALU && trace->alu.type == AluType::BRANCH) 
-    perf_stats_.branches += active_threads;
+    // update perf counters
+    uint32_t active_threads = trace->tmask.count();
+    if (trace->exe_type == ExeType::LSU && trace->lsu.type == LsuType::LOAD)
+      perf_stats_.loads += active_threads;
+    if (trace->exe_type == ExeType::LSU && trace->lsu.type == LsuType::STORE) 
+      perf_stats_.stores += active_threads;
+    if (trace->exe_type == ExeType::ALU && trace->alu.type == AluType::BRANCH) 
+      perf_stats_.branches += active_threads;
 
-  DT(3, "pipeline-decode: " << *trace);
+    DT(3, "pipeline-decode: " << *trace);
 
-  // insert to ibuffer 
-  ibuffer.push(trace);
+    // insert to ibuffer 
+    ibuffer.push(trace);
 
-  decode_latch_.pop();
+    decode_latch_.pop();
+  }
 }
 
 void Core::execute() {    
-  // issue ibuffer instructions
+  // issue up to ISSUE_WIDTH ibuffer instructions, one per execute unit
+  uint32_t issued = 0;
+  uint32_t busy_units = 0;
   for (auto& ibuffer : ibuffers_) {
     if (ibuffer.empty())
       continue;
 
     auto trace = ibuffer.top();
 
+    // wrong-path instructions wait for their branch to squash them
+    if (trace->wrong_path)
+      continue;
+
+    // check execute unit availability
+    uint32_t unit_mask = 1 << (int)trace->exe_type;
+    if (busy_units & unit_mask) {
+      ++perf_stats_.unit_stalls;
+      continue;
+    }
+
     // check scoreboard
     if (scoreboard_.in_use(trace)) {
       if (!trace->suspend()) {
+#ifndef NDEBUG
         DTH(3, "*** scoreboard-stall: dependents={");
         auto uses = scoreboard_.get_uses(trace);
         for (uint32_t i = 0, n = uses.size(); i < n; ++i) {
@@ -322,6 +624,7 @@ void Core::execute() {
           DTN(3, use.type << use.reg << "(#" << use.owner << ")");
         }
         DTN(3, "}, " << *trace << std::endl);
+#endif
       }
       ++perf_stats_.scrb_stalls;
       continue;
@@ -332,6 +635,11 @@ void Core::execute() {
     // update scoreboard
     scoreboard_.reserve(trace);
 
+    if (trace->exe_type == ExeType::LSU && trace->lsu.type == LsuType::LOAD) {
+      trace->issue_cycle = SimPlatform::instance().cycles();
+      scheduler_.load_issued(trace->wid);
+    }
+
     DT(3, "pipeline-issue: " << *trace);
 
     // push to execute units
@@ -344,21 +652,29 @@ void Core::execute() {
     }
 
     ibuffer.pop();
-    break;
+
+    busy_units |= unit_mask;
+    ++perf_stats_.issues;
+    if (++issued == ISSUE_WIDTH)
+      break;
   }
 }
 
 void Core::commit() {  
   // commit completed instructions
-  bool wb = false;
+  uint32_t wb_ports = 0;
   for (auto& exe_unit : exe_units_) {
     if (!exe_unit->Output.empty()) {
       auto trace = exe_unit->Output.front();    
 
-      // allow only one commit that updates registers
-      if (trace->wb && wb)
-        continue;        
-      wb |= trace->wb;
+      // allow up to WRITEBACK_PORTS commits that update registers
+      if (trace->wb) {
+        if (wb_ports == WRITEBACK_PORTS) {
+          ++perf_stats_.wb_stalls;
+          continue;
+        }
+        ++wb_ports;
+      }
 
       // advance to commit stage
       DT(3, "pipeline-commit: " << *trace);
@@ -366,13 +682,17 @@ void Core::commit() {
       // update scoreboard
       scoreboard_.release(trace);
 
+      if (trace->exe_type == ExeType::LSU && trace->lsu.type == LsuType::LOAD) {
+        scheduler_.load_completed(trace->wid, SimPlatform::instance().cycles() - trace->issue_cycle);
+      }
+
       assert(committed_instrs_ <= issued_instrs_);
       ++committed_instrs_;
 
       perf_stats_.instrs += trace->tmask.count();
 
-      // delete the trace
-      delete trace;
+      // recycle the trace
+      trace_pool_.release(trace);
 
       exe_unit->Output.pop();
     }
@@ -412,6 +732,75 @@ WarpMask Core::barrier(uint32_t bar_id, uint32_t count, uint32_t warp_id) {
   return ret;
 }
 
+const Instr* Core::get_instr(uint64_t pc, uint32_t* code) {
+  // translated fetches bypass the cache so that the TLB sees every access
+  if (nullptr == ram_ || (mmu_.get_satp() & 0x80000000) || (pc & 0x3)) {
+    this->icache_read(code, pc, sizeof(uint32_t));
+    uncached_instr_ = decoder_.decode(*code);
+    return uncached_instr_.get();
+  }
+
+  this->update_code();
+
+  auto entry = decode_cache_.lookup(pc);
+  if (entry) {
+    *code = entry->code;
+    return entry->instr.get();
+  }
+
+  // watch the page before reading it, so that no write is missed
+  ram_->watch_code(pc);
+  this->icache_read(code, pc, sizeof(uint32_t));
+  auto instr = decoder_.decode(*code);
+  if (instr) {
+    decode_cache_.insert(pc, *code, instr);
+  }
+  return instr.get();
+}
+
+void Core::update_code() {
+  // drop the decoded instructions and blocks of code pages written since
+  // the last check
+  auto version = ram_->code_version();
+  if (version == code_version_)
+    return;
+  std::vector<uint64_t> pages;
+  if (ram_->written_code(code_version_, &pages)) {
+    for (auto addr : pages) {
+      decode_cache_.invalidate(addr, ram_->page_size());
+      block_cache_.invalidate(addr, ram_->page_size());
+    }
+  } else {
+    decode_cache_.clear();
+    block_cache_.clear();
+  }
+  code_version_ = version;
+}
+
+const Superblock* Core::get_block(uint64_t pc) {
+  if (nullptr == ram_ || (mmu_.get_satp() & 0x80000000) || (pc & 0x3))
+    return nullptr;
+
+  this->update_code();
+
+  auto block = block_cache_.lookup(pc);
+  if (block)
+    return block;
+
+  // translate up to the first branch, jump or unsupported instruction
+  std::unique_ptr<Superblock> new_block(new Superblock(pc));
+  for (uint64_t addr = pc; new_block->size() < Superblock::MAX_OPS; addr += 4) {
+    uint32_t code = 0;
+    bool terminal = false;
+    auto instr = this->get_instr(addr, &code);
+    if (nullptr == instr || !new_block->translate(*instr, addr, &terminal))
+      break;
+    if (terminal)
+      break;
+  }
+  return block_cache_.insert(std::move(new_block));
+}
+
 void Core::icache_read(void *data, uint64_t addr, uint32_t size) {
   try  
   {
@@ -439,6 +828,14 @@ void Core::dcache_read(void *data, uint64_t addr, uint32_t size) {
         std::cout<<page_fault.what()<<std::endl;
         throw;
       }  
+      // forward the stores of this core not yet published
+      for (auto& write : pending_writes_) {
+        uint64_t start = std::max(addr, write.addr);
+        uint64_t end = std::min(addr + size, write.addr + write.size);
+        for (uint64_t a = start; a < end; ++a) {
+          ((uint8_t*)data)[a - addr] = ((const uint8_t*)&write.data)[a - write.addr];
+        }
+      }
   }
 }
 
@@ -451,6 +848,14 @@ void Core::dcache_write(const void* data, uint64_t addr, uint32_t size) {
     if (type == AddrType::Shared) {
       addr &= (SMEM_SIZE-1);
       smem_.write(data, addr, size);
+    } else if (!functional_) {
+      assert(size <= sizeof(uint64_t));
+      mem_write_t write;
+      write.addr = addr;
+      write.size = size;
+      write.data = 0;
+      memcpy(&write.data, data, size);
+      pending_writes_.push_back(write);
     } else {
       try  
       {
@@ -465,7 +870,22 @@ void Core::dcache_write(const void* data, uint64_t addr, uint32_t size) {
   }
 }
 
-uint32_t Core::tex_read(uint32_t unit, uint32_t u, uint32_t v, uint32_t lod, std::vector<mem_addr_size_t>* mem_addrs) {
+void Core::publish_writes() {
+  for (auto& write : pending_writes_) {
+    try  
+    {
+      mmu_.write(&write.data, write.addr, write.size, ACCESS_TYPE::STORE);
+    }
+    catch (Page_Fault_Exception& page_fault)  
+    {
+      std::cout<<page_fault.what()<<std::endl;
+      throw;
+    }
+  }
+  pending_writes_.clear();
+}
+
+uint32_t Core::tex_read(uint32_t unit, uint32_t u, uint32_t v, uint32_t lod, ThreadMemAddrs* mem_addrs) {
   return tex_units_.at(unit).read(u, v, lod, mem_addrs);
 }
 
@@ -477,7 +897,18 @@ void Core::writeToStdOut(const void* data, uint64_t addr, uint32_t size) {
   char c = *(char*)data;
   ss_buf << c;
   if (c == '\n') {
-    std::cout << std::dec << "#" << tid << ": " << ss_buf.str() << std::flush;
+    std::stringstream ss_line;
+    ss_line << std::dec << "#" << tid << ": " << ss_buf.str();
+    if (functional_) {
+      // no clock is running, print right away
+      std::cout << ss_line.str() << std::flush;
+    } else {
+      // print from the event queue so that output from cores 
+      // simulated on different host threads stays in order
+      SimPlatform::instance().schedule<std::string>([](const std::string& line) {
+        std::cout << line << std::flush;
+      }, ss_line.str(), 1);
+    }
     ss_buf.str("");
   }
 }
@@ -621,6 +1052,14 @@ uint32_t Core::get_csr(uint32_t addr, uint32_t tid, uint32_t wid) {
     return dcache_->perf_stats().mshr_stalls & 0xffffffff; 
   case CSR_MPM_DCACHE_MSHR_ST_H:
     return dcache_->perf_stats().mshr_stalls >> 32;
+  case CSR_MPM_DCACHE_PREF:
+    return dcache_->perf_stats().prefetches & 0xffffffff; 
+  case CSR_MPM_DCACHE_PREF_H:
+    return dcache_->perf_stats().prefetches >> 32;
+  case CSR_MPM_DCACHE_PREF_HIT:
+    return dcache_->perf_stats().prefetch_hits & 0xffffffff; 
+  case CSR_MPM_DCACHE_PREF_HIT_H:
+    return dcache_->perf_stats().prefetch_hits >> 32;
   
   case CSR_MPM_SMEM_READS:
     return shared_mem_->perf_stats().reads & 0xffffffff;
@@ -644,9 +1083,15 @@ uint32_t Core::get_csr(uint32_t addr, uint32_t tid, uint32_t wid) {
   case CSR_MPM_MEM_WRITES_H:
     return perf_stats_.mem_writes >> 32; 
   case CSR_MPM_MEM_LAT:
+    this->update_mem_latency();
     return perf_stats_.mem_latency & 0xffffffff; 
   case CSR_MPM_MEM_LAT_H:
+    this->update_mem_latency();
     return perf_stats_.mem_latency >> 32; 
+  case CSR_MPM_SCHED_ST:
+    return scheduler_.perf_stats().stalls & 0xffffffff;
+  case CSR_MPM_SCHED_ST_H:
+    return scheduler_.perf_stats().stalls >> 32;
 
 #ifdef EXT_TEX_ENABLE
   case CSR_MPM_TEX_READS:
@@ -715,11 +1160,105 @@ void Core::trigger_ebreak() {
   ebreak_ = true;
 }
 
+void Core::save(CheckpointWriter& writer) const {
+  // the pipeline must be drained, only architectural and cache state remains
+  assert(!this->running());
+  writer.section("core");
+  writer.write(id_);
+  for (auto& warp : warps_) {
+    warp->save(writer);
+  }
+  for (auto& barrier : barriers_) {
+    writer.write<uint32_t>(barrier.to_ulong());
+  }
+  writer.write(csrs_);
+  writer.write(fcsrs_);
+  writer.write<uint32_t>(active_warps_.to_ulong());
+  writer.write<uint32_t>(stalled_warps_.to_ulong());
+  scheduler_.save(writer);
+  predictor_.save(writer);
+  writer.write(issued_instrs_);
+  writer.write(committed_instrs_);
+  writer.write(csr_tex_unit_);
+  writer.write(ecall_);
+  writer.write(ebreak_);
+  for (auto& tex_unit : tex_units_) {
+    for (uint32_t i = 0; i < NUM_TEX_STATES; ++i) {
+      writer.write(tex_unit.get_state(i));
+    }
+  }
+  writer.write<uint32_t>(print_bufs_.size());
+  for (auto& buf : print_bufs_) {
+    writer.write(buf.first);
+    writer.write(buf.second.str());
+  }
+  this->update_mem_latency();
+  this->update_skipped_cycles();
+  writer.write(perf_stats_);
+  mmu_.save(writer);
+  smem_.save(writer);
+  icache_->save(writer);
+  dcache_->save(writer);
+  shared_mem_->save(writer);
+  bcu_->save(writer);
+}
+
+void Core::restore(CheckpointReader& reader) {
+  reader.section("core");
+  reader.expect(id_, "core id");
+  for (auto& warp : warps_) {
+    warp->restore(reader);
+  }
+  for (auto& barrier : barriers_) {
+    barrier = reader.read<uint32_t>();
+  }
+  reader.read(&csrs_);
+  reader.read(&fcsrs_);
+  active_warps_ = reader.read<uint32_t>();
+  stalled_warps_ = reader.read<uint32_t>();
+  scheduler_.restore(reader);
+  predictor_.restore(reader);
+  reader.read(&issued_instrs_);
+  reader.read(&committed_instrs_);
+  reader.read(&csr_tex_unit_);
+  reader.read(&ecall_);
+  reader.read(&ebreak_);
+  for (auto& tex_unit : tex_units_) {
+    for (uint32_t i = 0; i < NUM_TEX_STATES; ++i) {
+      tex_unit.set_state(i, reader.read<uint32_t>());
+    }
+  }
+  print_bufs_.clear();
+  for (uint32_t i = 0, n = reader.read<uint32_t>(); i < n; ++i) {
+    auto tid = reader.read<int>();
+    print_bufs_[tid] << reader.read<std::string>();
+  }
+  reader.read(&perf_stats_);
+  this->update_skip_stalls();
+  mmu_.restore(reader);
+  smem_.restore(reader);
+  icache_->restore(reader);
+  dcache_->restore(reader);
+  shared_mem_->restore(reader);
+  bcu_->restore(reader);
+}
+
 bool Core::check_exit() const {
   return ebreak_ || ecall_;
 }
 
+bool Core::stores_buffered() const {
+  auto lsu = std::static_pointer_cast<LsuUnit>(exe_units_.at((int)ExeType::LSU));
+  return lsu->stores_buffered();
+}
+
 bool Core::running() const {
-  bool is_running = (committed_instrs_ != issued_instrs_);
+  // buffered stores keep the LSU busy until they reach the dcache,
+  // mispredicted warps stay stalled until their redirect, and squashed
+  // wrong-path instructions may still be in the front-end
+  bool is_running = (committed_instrs_ != issued_instrs_)
+                 || !exe_units_.at((int)ExeType::LSU)->idle()
+                 || (pending_redirects_ != 0)
+                 || (wrong_path_traces_ != 0);
   return is_running;
 }
\ No newline at end of file
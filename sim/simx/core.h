@@ -13,6 +13,7 @@
 #include "types.h"
 #include "archdef.h"
 #include "decode.h"
+#include "superblock.h"
 #include "mem.h"
 #include "warp.h"
 #include "pipeline.h"
@@ -20,6 +21,8 @@
 #include "sharedmem.h"
 #include "ibuffer.h"
 #include "scoreboard.h"
+#include "scheduler.h"
+#include "predictor.h"
 #include "exeunit.h"
 #include "tex_unit.h"
 #include "bcu.h"
@@ -37,9 +40,19 @@ public:
     uint64_t csr_stalls;
     uint64_t fpu_stalls;
     uint64_t gpu_stalls;
+    uint64_t issues;
+    uint64_t unit_stalls;
+    uint64_t wb_stalls;
     uint64_t loads;
     uint64_t stores;
     uint64_t branches;
+    uint64_t wrong_path_fetches;
+    uint64_t dcache_instrs;
+    uint64_t dcache_reqs;
+    uint64_t stores_buffered;
+    uint64_t store_merges;
+    uint64_t store_drains;
+    uint64_t store_forwards;
     uint64_t mem_reads;
     uint64_t mem_writes;
     uint64_t mem_latency;
@@ -55,9 +68,19 @@ public:
       , csr_stalls(0)
       , fpu_stalls(0)
       , gpu_stalls(0)
+      , issues(0)
+      , unit_stalls(0)
+      , wb_stalls(0)
       , loads(0)
       , stores(0)
       , branches(0)
+      , wrong_path_fetches(0)
+      , dcache_instrs(0)
+      , dcache_reqs(0)
+      , stores_buffered(0)
+      , store_merges(0)
+      , store_drains(0)
+      , store_forwards(0)
       , mem_reads(0)
       , mem_writes(0)
       , mem_latency(0)
@@ -76,8 +99,18 @@ public:
 
   bool running() const;
 
+  // stores still waiting in the LSU store buffer
+  bool stores_buffered() const;
+
+  // true until every warp has exited
+  bool active() const {
+    return active_warps_.any();
+  }
+
   void reset();
 
+  bool idle() const;
+
   void tick();
 
   uint32_t id() const {
@@ -93,6 +126,8 @@ public:
   }
 
   const PerfStats& perf_stats() const {
+    this->update_mem_latency();
+    this->update_skipped_cycles();
     return perf_stats_;
   } 
 
@@ -108,13 +143,24 @@ public:
   
   WarpMask barrier(uint32_t bar_id, uint32_t count, uint32_t warp_id);
 
+  // decoded instruction at pc, reused until its code page is written
+  const Instr* get_instr(uint64_t pc, uint32_t* code);
+
+  // translated block at pc, nullptr when fetches go through the MMU
+  const Superblock* get_block(uint64_t pc);
+
+  // true once code has been written since blocks were translated
+  bool code_written() const {
+    return ram_->code_version() != code_version_;
+  }
+
   void icache_read(void* data, uint64_t addr, uint32_t size);
 
   void dcache_read(void* data, uint64_t addr, uint32_t size);
 
   void dcache_write(const void* data, uint64_t addr, uint32_t size);
 
-  uint32_t tex_read(uint32_t unit, uint32_t lod, uint32_t u, uint32_t v, std::vector<mem_addr_size_t>* mem_addrs);
+  uint32_t tex_read(uint32_t unit, uint32_t lod, uint32_t u, uint32_t v, ThreadMemAddrs* mem_addrs);
 
   void trigger_ecall();
 
@@ -122,6 +168,59 @@ public:
 
   bool check_exit() const;
 
+  void set_warp_policy(WarpPolicy policy) {
+    scheduler_.set_policy(policy);
+  }
+
+  const WarpScheduler& scheduler() const {
+    this->update_skipped_cycles();
+    return scheduler_;
+  }
+
+  void set_branch_policy(BranchPolicy policy) {
+    predictor_.set_policy(policy);
+  }
+
+  const BranchPredictor& predictor() const {
+    return predictor_;
+  }
+
+  const Cache::PerfStats& icache_stats() const {
+    return icache_->perf_stats();
+  }
+
+  const Cache::PerfStats& dcache_stats() const {
+    return dcache_->perf_stats();
+  }
+
+  const std::vector<uint64_t>& dcache_bank_conflicts() const {
+    return dcache_->bank_conflicts();
+  }
+
+  const std::vector<uint64_t>& smem_bank_conflicts() const {
+    return shared_mem_->bank_conflicts();
+  }
+
+  // stop issuing new instructions so that the pipeline drains
+  void drain(bool enable) {
+    this->update_skipped_cycles();
+    draining_ = enable;
+    this->update_skip_stalls();
+  }
+
+  // bypass the timing pipeline
+  void functional(bool enable) {
+    functional_ = enable;
+  }
+
+  // execute up to quantum instructions per active warp without the timing
+  // pipeline, returns the number of instructions executed
+  uint64_t step_functional(uint32_t quantum);
+
+  void save(CheckpointWriter& writer) const;
+
+  void restore(CheckpointReader& reader);
+
 private:
 
   void schedule();
@@ -132,11 +231,43 @@ private:
   
   void writeToStdOut(const void* data, uint64_t addr, uint32_t size);
 
+  // apply the stores staged during this cycle to memory
+  void publish_writes();
+
   void cout_flush();
 
+  void update_mem_latency() const;
+
+  void update_code();
+
+  // mispredicted warps are released once the penalty has elapsed
+  void redirect_warp(uint32_t wid, uint32_t penalty);
+
+  void update_redirects();
+
+  void fetch_wrong_path(uint32_t wid);
+
+  void squash_warp(uint32_t wid);
+
+  bool is_squashed(const pipeline_trace_t* trace) const {
+    return trace->wrong_path 
+        && (trace->squash_epoch != squash_epochs_.at(trace->wid));
+  }
+
+  void release_wrong_path(pipeline_trace_t* trace);
+
+  void update_skip_stalls();
+
+  void update_skipped_cycles() const;
+
   uint32_t id_;
   const ArchDef arch_;
   const Decoder decoder_;
+  DecodeCache decode_cache_;
+  BlockCache block_cache_;
+  uint64_t code_version_;
+  std::shared_ptr<Instr> uncached_instr_;
+  RAM* ram_;
   MemoryUnit mmu_;
   RAM smem_;
   std::vector<TexUnit> tex_units_;
@@ -147,7 +278,15 @@ private:
   std::vector<uint32_t> csrs_;
   std::vector<Byte> fcsrs_;
   std::vector<IBuffer> ibuffers_;
+  std::vector<uint64_t> redirect_cycles_;
+  uint32_t pending_redirects_;
+  WarpMask wrong_path_warps_;
+  std::vector<Word> wrong_path_pcs_;
+  std::vector<uint32_t> squash_epochs_;
+  uint32_t wrong_path_traces_;
   Scoreboard scoreboard_;
+  mutable WarpScheduler scheduler_;
+  BranchPredictor predictor_;
   std::vector<ExeUnit::Ptr> exe_units_;
   RbtMem::Ptr rbt_mem_;
   BcuUnit::Ptr bcu_;
@@ -161,21 +300,46 @@ private:
 
   PipelineLatch fetch_latch_;
   PipelineLatch decode_latch_;
+
+  PipelineTracePool trace_pool_;
   
   HashTable<pipeline_trace_t*> pending_icache_;
   WarpMask active_warps_;
   WarpMask stalled_warps_;
-  uint32_t last_schedule_wid_;
   uint64_t issued_instrs_;
   uint64_t committed_instrs_;
   uint32_t csr_tex_unit_;
   bool ecall_;
   bool ebreak_;
+  bool draining_;
+  bool functional_;
 
   std::unordered_map<int, std::stringstream> print_bufs_;
+
+  // stores to global memory are staged until the end of the cycle and
+  // published in core order, so that other cores observe them at the same
+  // time whether or not they are simulated on another host thread
+  struct mem_write_t {
+    uint64_t addr;
+    uint32_t size;
+    uint64_t data;
+  };
+  std::vector<mem_write_t> pending_writes_;
   
-  PerfStats perf_stats_;
+  mutable PerfStats perf_stats_;
   uint64_t perf_mem_pending_reads_;
+  mutable uint64_t perf_mem_latency_cycle_;
+
+  // stall counters that each cycle adds while the core is idle and 
+  // skipped, taken at the end of its last tick
+  struct skip_stalls_t {
+    uint32_t sched_idles;
+    uint32_t sched_stalls;
+    uint32_t ibuf_stalls;
+    uint32_t scrb_stalls;
+  };
+  skip_stalls_t skip_stalls_;
+  mutable uint64_t perf_skip_cycle_;
 
   friend class LsuUnit;
   friend class AluUnit;
@@ -647,3 +647,45 @@ std::shared_ptr<Instr> Decoder::decode(uint32_t code) const {
 
   return instr;
 }
+
+///////////////////////////////////////////////////////////////////////////////
+
+DecodeCache::DecodeCache()
+  : last_page_(nullptr)
+  , last_page_index_(0)
+{}
+
+void DecodeCache::insert(uint64_t pc, uint32_t code, const std::shared_ptr<Instr>& instr) {
+  auto page_index = pc >> PAGE_BITS;
+  auto page = this->get_page(page_index);
+  if (nullptr == page) {
+    auto& entries = pages_[page_index];
+    entries.resize(PAGE_ENTRIES);
+    page = entries.data();
+    last_page_ = page;
+    last_page_index_ = page_index;
+  }
+  auto& entry = page[(pc >> 2) & (PAGE_ENTRIES - 1)];
+  entry.code  = code;
+  entry.instr = instr;
+}
+
+void DecodeCache::invalidate(uint64_t addr, uint64_t size) {
+  if (0 == size)
+    return;
+  for (uint64_t pc = addr & ~3ull, end = addr + size; pc < end; pc += 4) {
+    auto page = this->get_page(pc >> PAGE_BITS);
+    if (nullptr == page) {
+      // skip to the next page
+      pc = (((pc >> PAGE_BITS) + 1) << PAGE_BITS) - 4;
+      continue;
+    }
+    page[(pc >> 2) & (PAGE_ENTRIES - 1)] = entry_t();
+  }
+}
+
+void DecodeCache::clear() {
+  pages_.clear();
+  last_page_ = nullptr;
+  last_page_index_ = 0;
+}
@@ -2,6 +2,7 @@
 
 #include <vector>
 #include <memory>
+#include <unordered_map>
 
 namespace vortex {
 
@@ -15,4 +16,52 @@ public:
   std::shared_ptr<Instr> decode(uint32_t code) const;
 };
 
+// Decoded instructions indexed by PC, grouped by code page.
+class DecodeCache {
+public:
+  struct entry_t {
+    uint32_t code;
+    std::shared_ptr<Instr> instr;
+  };
+
+  DecodeCache();
+
+  const entry_t* lookup(uint64_t pc) {
+    auto page = this->get_page(pc >> PAGE_BITS);
+    if (nullptr == page)
+      return nullptr;
+    auto& entry = page[(pc >> 2) & (PAGE_ENTRIES - 1)];
+    if (nullptr == entry.instr)
+      return nullptr;
+    return &entry;
+  }
+
+  void insert(uint64_t pc, uint32_t code, const std::shared_ptr<Instr>& instr);
+
+  // drop the entries within [addr, addr + size)
+  void invalidate(uint64_t addr, uint64_t size);
+
+  void clear();
+
+private:
+
+  static constexpr uint32_t PAGE_BITS    = 12;
+  static constexpr uint32_t PAGE_ENTRIES = 1 << (PAGE_BITS - 2);
+
+  entry_t* get_page(uint64_t page_index) {
+    if (last_page_ && last_page_index_ == page_index)
+      return last_page_;
+    auto it = pages_.find(page_index);
+    if (it == pages_.end())
+      return nullptr;
+    last_page_ = it->second.data();
+    last_page_index_ = page_index;
+    return last_page_;
+  }
+
+  std::unordered_map<uint64_t, std::vector<entry_t>> pages_;
+  entry_t* last_page_;
+  uint64_t last_page_index_;
+};
+
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include <unistd.h>
 #include <math.h>
 #include <bitset>
+#include <array>
 #include <climits>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -22,21 +23,21 @@ union reg_data_t {
 };
 
 static bool HasDivergentThreads(const ThreadMask &thread_mask,                                
-                                const std::vector<std::vector<Word>> &reg_file,
+                                const RegFile<Word> &reg_file,
                                 unsigned reg) {
   bool cond;
   size_t thread_idx = 0;
-  size_t num_threads = reg_file.size();
+  size_t num_threads = reg_file.num_threads();
   for (; thread_idx < num_threads; ++thread_idx) {
     if (thread_mask[thread_idx]) {
-      cond = bool(reg_file[thread_idx][reg]);
+      cond = bool(reg_file.at(thread_idx, reg));
       break;
     }
   }  
   assert(thread_idx != num_threads);  
   for (; thread_idx < num_threads; ++thread_idx) {
     if (thread_mask[thread_idx]) {
-      if (cond != (bool(reg_file[thread_idx][reg]))) {
+      if (cond != (bool(reg_file.at(thread_idx, reg)))) {
         return true;
       }
     }
@@ -102,9 +103,120 @@ static bool checkBoxedCmpArgs(Word* out, FWord a, FWord b, uint32_t* fflags) {
   return false;
 }
 
+// Integer ALU and branch instructions run on whole register lanes at once.
+
+bool Warp::execute_lanes(const Instr &instr, pipeline_trace_t *trace) {
+#ifdef EXECUTE_LANES
+  static const lanes::AluOp alu_ops[8] = {
+    lanes::AluOp::ADD, lanes::AluOp::SLL, lanes::AluOp::SLT, lanes::AluOp::SLTU,
+    lanes::AluOp::XOR, lanes::AluOp::SRL, lanes::AluOp::OR, lanes::AluOp::AND
+  };
+  static const lanes::CmpOp cmp_ops[8] = {
+    lanes::CmpOp::EQ, lanes::CmpOp::NE, lanes::CmpOp::EQ, lanes::CmpOp::EQ,
+    lanes::CmpOp::LT, lanes::CmpOp::GE, lanes::CmpOp::LTU, lanes::CmpOp::GEU
+  };
+
+  auto opcode = instr.getOpcode();
+  auto func3  = instr.getFunc3();
+  auto func7  = instr.getFunc7();
+  auto rdest  = instr.getRDest();
+  auto rsrc0  = instr.getRSrc(0);
+  auto rsrc1  = instr.getRSrc(1);
+  auto immsrc = sext((Word)instr.getImm(), 32);
+
+  auto num_lanes = ireg_file_.stride();
+  uint32_t tmask = tmask_.to_ulong();
+  auto nextPC = PC_ + core_->arch().wsize();
+
+  switch (opcode) {
+  case LUI_INST:
+  case AUIPC_INST: {
+    trace->exe_type = ExeType::ALU;
+    trace->alu.type = AluType::ARITH;
+    if (rdest) {
+      Word value = (opcode == LUI_INST) ? (immsrc << 12) : ((immsrc << 12) + PC_);
+      lanes::fill(ireg_file_.lanes(rdest), value, num_lanes, tmask);
+      trace->used_iregs[rdest] = 1;
+    }
+    trace->wb = true;
+    break;
+  }
+  case R_INST: {
+    lanes::AluOp op;
+    if (func7 & 0x1) {
+      // RV32M: only MUL maps to a lane operation
+      if (func3 != 0)
+        return false;
+      op = lanes::AluOp::MUL;
+    } else {
+      op = alu_ops[func3];
+      if (func7) {
+        if (func3 == 0) {
+          op = lanes::AluOp::SUB;
+        } else if (func3 == 5) {
+          op = lanes::AluOp::SRA;
+        }
+      }
+    }
+    trace->exe_type = ExeType::ALU;
+    trace->alu.type = (op == lanes::AluOp::MUL) ? AluType::IMUL : AluType::ARITH;
+    trace->used_iregs.set(rsrc0);
+    trace->used_iregs.set(rsrc1);
+    if (rdest) {
+      lanes::alu(op, ireg_file_.lanes(rdest), ireg_file_.lanes(rsrc0), ireg_file_.lanes(rsrc1), num_lanes, tmask);
+      trace->used_iregs[rdest] = 1;
+    }
+    trace->wb = true;
+    break;
+  }
+  case I_INST: {
+    auto op = alu_ops[func3];
+    if (func3 == 5 && func7) {
+      op = lanes::AluOp::SRA;
+    }
+    trace->exe_type = ExeType::ALU;
+    trace->alu.type = AluType::ARITH;
+    trace->used_iregs.set(rsrc0);
+    if (rdest) {
+      lanes::alu_imm(op, ireg_file_.lanes(rdest), ireg_file_.lanes(rsrc0), immsrc, num_lanes, tmask);
+      trace->used_iregs[rdest] = 1;
+    }
+    trace->wb = true;
+    break;
+  }
+  case B_INST: {
+    if (func3 == 2 || func3 == 3)
+      return false;
+    trace->exe_type = ExeType::ALU;
+    trace->alu.type = AluType::BRANCH;
+    trace->used_iregs.set(rsrc0);
+    trace->used_iregs.set(rsrc1);
+    // the first active thread decides the branch
+    auto taken = lanes::cmp(cmp_ops[func3], ireg_file_.lanes(rsrc0), ireg_file_.lanes(rsrc1), num_lanes, tmask);
+    if (taken & tmask & -tmask) {
+      nextPC = uint32_t(PC_ + immsrc);
+    }
+    trace->fetch_stall = true;
+    break;
+  }
+  default:
+    return false;
+  }
+
+  PC_ = nextPC;
+  return true;
+#else
+  __unused(instr, trace);
+  return false;
+#endif
+}
+
 void Warp::execute(const Instr &instr, pipeline_trace_t *trace) {
   assert(tmask_.any());
 
+  if (this->execute_lanes(instr, trace))
+    return;
+
   auto nextPC = PC_ + core_->arch().wsize();
 
   auto func2  = instr.getFunc2();
@@ -122,8 +234,8 @@ void Warp::execute(const Instr &instr, pipeline_trace_t *trace) {
 
   auto num_threads = core_->arch().num_threads();
 
-  std::vector<reg_data_t[3]> rsdata(num_threads);
-  std::vector<reg_data_t> rddata(num_threads);
+  std::array<std::array<reg_data_t, 3>, ThreadMask().size()> rsdata;
+  std::array<reg_data_t, ThreadMask().size()> rddata;
 
   auto num_rsrcs = instr.getNRSrc();
   if (num_rsrcs) {              
@@ -140,7 +252,7 @@ void Warp::execute(const Instr &instr, pipeline_trace_t *trace) {
             DPN(2, "-");
             continue;            
           }
-          rsdata[t][i].i = ireg_file_.at(t)[reg];          
+          rsdata[t][i].i = ireg_file_.at(t, reg);          
           DPN(2, std::hex << rsdata[t][i].i); 
         }
         DPN(2, "}" << std::endl);
@@ -153,7 +265,7 @@ void Warp::execute(const Instr &instr, pipeline_trace_t *trace) {
             DPN(2, "-");
             continue;            
           }
-          rsdata[t][i].f = freg_file_.at(t)[reg];
+          rsdata[t][i].f = freg_file_.at(t, reg);
           DPN(2, std::hex << rsdata[t][i].f); 
         }
         DPN(2, "}" << std::endl);
@@ -1296,7 +1408,7 @@ void Warp::execute(const Instr &instr, pipeline_trace_t *trace) {
         // predicate mode
         ThreadMask pred;
         for (uint32_t t = 0; t < num_threads; ++t) {
-          pred[t] = tmask_.test(t) ? (ireg_file_.at(t).at(rsrc0) != 0) : 0;
+          pred[t] = tmask_.test(t) ? (ireg_file_.at(t, rsrc0) != 0) : 0;
         }
         if (pred.any()) {
           tmask_ &= pred;
@@ -1334,7 +1446,7 @@ void Warp::execute(const Instr &instr, pipeline_trace_t *trace) {
       if (HasDivergentThreads(tmask_, ireg_file_, rsrc0)) {          
         ThreadMask tmask;
         for (uint32_t t = 0; t < num_threads; ++t) {
-          tmask[t] = tmask_.test(t) && !ireg_file_.at(t).at(rsrc0);
+          tmask[t] = tmask_.test(t) && !ireg_file_.at(t, rsrc0);
         }
 
         DomStackEntry e(tmask, nextPC);
@@ -2317,7 +2429,7 @@ void Warp::execute(const Instr &instr, pipeline_trace_t *trace) {
             DPN(2, "-");
             continue;            
           }
-          ireg_file_.at(t)[rdest] = rddata[t].i;
+          ireg_file_.at(t, rdest) = rddata[t].i;
           DPN(2, "0x" << std::hex << rddata[t].i);         
         }
         DPN(2, "}" << std::endl);
@@ -2332,7 +2444,7 @@ void Warp::execute(const Instr &instr, pipeline_trace_t *trace) {
           DPN(2, "-");
           continue;            
         }
-        freg_file_.at(t)[rdest] = rddata[t].f;        
+        freg_file_.at(t, rdest) = rddata[t].f;        
         DPN(2, "0x" << std::hex << rddata[t].f);         
       }
       DPN(2, "}" << std::endl);
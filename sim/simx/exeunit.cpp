@@ -26,14 +26,86 @@ LsuUnit::LsuUnit(const SimContext& ctx, Core* core)
     : ExeUnit(ctx, core, "LSU")
     , num_threads_(core->arch().num_threads()) 
     , pending_rd_reqs_(LSUQ_SIZE)
+    , store_flush_(false)
     , fence_lock_(false)
-{}
+{
+    static_assert(L1_BLOCK_SIZE <= 64, "store buffer byte mask too small");
+    store_buffer_.reserve(STORE_BUFFER_SIZE);
+}
 
 void LsuUnit::reset() {
     pending_rd_reqs_.clear();
+    store_buffer_.clear();
+    store_flush_ = false;
     fence_lock_ = false;
 }
 
+bool LsuUnit::idle() const {
+    if (!store_buffer_.empty())
+        return false;
+    for (uint32_t t = 0; t < num_threads_; ++t) {
+        if (!core_->dcache_switch_.at(t)->RspOut.at(0).empty()
+         || !core_->shared_mem_->Outputs.at(t).empty())
+            return false;
+    }
+    if (fence_lock_)
+        return !pending_rd_reqs_.empty();
+    return Input.empty();
+}
+
+void LsuUnit::complete(uint32_t tag, uint32_t t) {
+    auto& entry = pending_rd_reqs_.at(tag);
+    auto threads = entry.port_threads.at(t);
+    assert((entry.pending & threads) == threads);
+    entry.pending &= ~threads;
+    if (entry.pending.none()) {
+        Output.send(entry.trace, 1);
+        pending_rd_reqs_.release(tag);
+    }
+}
+
+LsuUnit::store_entry_t* LsuUnit::find_store(uint64_t line) {
+    for (auto& entry : store_buffer_) {
+        if (entry.line == line)
+            return &entry;
+    }
+    return nullptr;
+}
+
+void LsuUnit::drain_stores() {
+    auto cycle = SimPlatform::instance().cycles();
+    while (!store_buffer_.empty()) {
+        auto& entry = store_buffer_.front();
+        if (!store_flush_ 
+         && store_buffer_.size() != STORE_BUFFER_SIZE
+         && (cycle - entry.cycle) < STORE_BUFFER_WINDOW)
+            break;
+        auto& dcache_req_port = core_->dcache_switch_.at(entry.port)->ReqIn.at(0);
+        if (dcache_req_port.full())
+            break;
+        MemReq mem_req;
+        mem_req.addr  = entry.line * L1_BLOCK_SIZE;
+        mem_req.write = true;
+        mem_req.tag   = 0;
+        mem_req.core_id = entry.core_id;
+        mem_req.uuid = entry.uuid;
+        for (uint32_t i = 0; i < L1_BLOCK_SIZE; ++i) {
+            if ((entry.byte_mask >> i) & 1) {
+                mem_req.sector_mask |= sector_mask(mem_req.addr + i, 1);
+            }
+        }
+        dcache_req_port.send(mem_req, 2);
+        DT(3, "store-drain: addr=" << std::hex << mem_req.addr << ", mask=" << entry.byte_mask 
+            << std::dec << ", port=" << entry.port << ", age=" << (cycle - entry.cycle) << " (#" << entry.uuid << ")");
+        ++core_->perf_stats_.store_drains;
+        ++core_->perf_stats_.dcache_reqs;
+        store_buffer_.erase(store_buffer_.begin());
+    }
+    if (store_buffer_.empty()) {
+        store_flush_ = false;
+    }
+}
+
 void LsuUnit::tick() {
     // handle dcache response
     for (uint32_t t = 0; t < num_threads_; ++t) {
@@ -41,16 +113,11 @@ void LsuUnit::tick() {
         if (dcache_rsp_port.empty())
             continue;
         auto& mem_rsp = dcache_rsp_port.front();
-        auto& entry = pending_rd_reqs_.at(mem_rsp.tag);          
-        auto trace = entry.first;
+        auto trace = pending_rd_reqs_.at(mem_rsp.tag).trace;
         DT(3, "dcache-rsp: tag=" << mem_rsp.tag << ", type=" << trace->lsu.type 
             << ", tid=" << t << ", " << *trace);  
-        assert(entry.second);
-        --entry.second; // track remaining blocks 
-        if (0 == entry.second) {
-            Output.send(trace, 1);
-            pending_rd_reqs_.release(mem_rsp.tag);
-        } 
+        __unused (trace);
+        this->complete(mem_rsp.tag, t);
         dcache_rsp_port.pop();  
     }
 
@@ -60,22 +127,20 @@ void LsuUnit::tick() {
         if (smem_rsp_port.empty())
             continue;
         auto& mem_rsp = smem_rsp_port.front();
-        auto& entry = pending_rd_reqs_.at(mem_rsp.tag);          
-        auto trace = entry.first;
+        auto trace = pending_rd_reqs_.at(mem_rsp.tag).trace;
         DT(3, "smem-rsp: tag=" << mem_rsp.tag << ", type=" << trace->lsu.type 
             << ", tid=" << t << ", " << *trace);  
-        assert(entry.second);
-        --entry.second; // track remaining blocks 
-        if (0 == entry.second) {
-            Output.send(trace, 1);
-            pending_rd_reqs_.release(mem_rsp.tag);
-        } 
+        __unused (trace);
+        this->complete(mem_rsp.tag, t);
         smem_rsp_port.pop();  
     }
 
+    this->drain_stores();
+
     if (fence_lock_) {
         // wait for all pending memory operations to complete
-        if (!pending_rd_reqs_.empty())
+        store_flush_ = true;
+        if (!pending_rd_reqs_.empty() || !store_buffer_.empty())
             return;
         Output.send(fence_state_, 1);
         fence_lock_ = false;
@@ -110,41 +175,145 @@ void LsuUnit::tick() {
     }
     
     bool is_write = (trace->lsu.type == LsuType::STORE);
+    bool buffered = (STORE_BUFFER_SIZE != 0);
+
+    // coalesce the cacheable accesses of the warp into one request per
+    // cache line, sent on the port of the first thread touching the line.
+    // Shared memory and I/O accesses keep one request per thread.
+    // Cacheable stores go to the store buffer instead, and loads fully
+    // covered by buffered stores are forwarded from it.
+    pending_req_t entry;
+    entry.trace = trace;
+    uint32_t leaders[ThreadMask().size()];
+    uint64_t lines[ThreadMask().size()];
+    uint32_t num_lines = 0;
+    uint32_t new_lines = 0;
+    uint32_t forwards = 0;
+    bool dcache_access = false;
+    for (uint32_t t = 0; t < num_threads_; ++t) {
+        entry.port_threads.at(t).reset();
+        if (!trace->tmask.test(t))
+            continue;
+        auto mem_addr = trace->mem_addrs.at(t).at(0);
+        auto type = get_addr_type(mem_addr.addr, mem_addr.size);
+        uint32_t leader = t;
+        dcache_access |= (type != AddrType::Shared);
+        if (type == AddrType::Global) {
+            uint64_t line = mem_addr.addr / L1_BLOCK_SIZE;
+            if (buffered && !is_write) {
+                auto store = this->find_store(line);
+                if (store) {
+                    uint64_t offset = mem_addr.addr % L1_BLOCK_SIZE;
+                    uint64_t mask = ((uint64_t(1) << mem_addr.size) - 1) << offset;
+                    if ((store->byte_mask & mask) == mask) {
+                        ++forwards;
+                        continue;
+                    }
+                    if (store->byte_mask & mask) {
+                        // partial overlap, drain the buffer first
+                        store_flush_ = true;
+                        if (!trace->suspend()) {
+                            DT(3, "*** lsu-store-stall: tid=" << t << ", " << *trace);
+                        }
+                        return;
+                    }
+                }
+            }
+            uint32_t i = 0;
+            while (i < num_lines && lines[i] != line) {
+                ++i;
+            }
+            if (i == num_lines) {
+                lines[num_lines] = line;
+                leaders[num_lines] = t;
+                ++num_lines;
+                if (buffered && is_write && !this->find_store(line)) {
+                    ++new_lines;
+                }
+            }
+            leader = leaders[i];
+        }
+        entry.port_threads.at(leader).set(t);
+        entry.pending.set(t);
+    }
 
-    // duplicates detection
-    bool is_dup = false;
-    if (trace->tmask.test(0)) {
-        uint64_t addr_mask = sizeof(uint32_t)-1;
-        uint32_t addr0 = trace->mem_addrs.at(0).at(0).addr & ~addr_mask;
-        uint32_t matches = 1;
-        for (uint32_t t = 1; t < num_threads_; ++t) {
-            if (!trace->tmask.test(t))
-                continue;
-            auto mem_addr = trace->mem_addrs.at(t).at(0).addr & ~addr_mask;
-            matches += (addr0 == mem_addr);
+    // check store buffer capacity; a store touching more lines than the
+    // buffer holds is written through once the buffer has drained
+    if (store_buffer_.size() + new_lines > STORE_BUFFER_SIZE) {
+        if (!store_buffer_.empty()) {
+            store_flush_ = true;
+            if (!trace->suspend()) {
+                DT(3, "*** lsu-store-stall: " << *trace);
+            }
+            return;
         }
-        is_dup = (matches == trace->tmask.count());
+        buffered = false;
     }
 
-    uint32_t valid_addrs = 0;
-    if (is_dup) {
-        valid_addrs = 1;
-    } else {
-        for (auto& mem_addr : trace->mem_addrs) {
-            valid_addrs += mem_addr.size();
+    // check dcache request queues
+    for (uint32_t t = 0; t < num_threads_; ++t) {
+        if (entry.port_threads.at(t).none())
+            continue;
+        auto mem_addr = trace->mem_addrs.at(t).at(0);
+        auto type = get_addr_type(mem_addr.addr, mem_addr.size);
+        if (type != AddrType::Shared
+         && !(buffered && is_write && type == AddrType::Global)
+         && core_->dcache_switch_.at(t)->ReqIn.at(0).full()) {
+            if (!trace->suspend()) {
+                DT(3, "*** lsu-dcache-stall: tid=" << t << ", " << *trace);
+            }
+            return;
         }
     }
 
-    auto tag = pending_rd_reqs_.allocate({trace, valid_addrs});
+    if (forwards != 0) {
+        core_->perf_stats_.store_forwards += forwards;
+        DT(3, "store-forward: threads=" << forwards << ", " << *trace);
+    }
+
+    // loads fully served by the store buffer
+    if (entry.pending.none()) {
+        ++core_->perf_stats_.dcache_instrs;
+        Output.send(trace, 1);
+        auto time = Input.pop();
+        core_->perf_stats_.lsu_stalls += (SimPlatform::instance().cycles() - time);
+        return;
+    }
+
+    auto tag = pending_rd_reqs_.allocate(entry);
 
+    uint32_t dcache_reqs = 0;
     for (uint32_t t = 0; t < num_threads_; ++t) {
-        if (!trace->tmask.test(t))
+        auto threads = entry.port_threads.at(t);
+        if (threads.none())
             continue;
         
         auto& dcache_req_port = core_->dcache_switch_.at(t)->ReqIn.at(0);        
         auto mem_addr = trace->mem_addrs.at(t).at(0);
         auto type = get_addr_type(mem_addr.addr, mem_addr.size);
 
+        if (buffered && is_write && type == AddrType::Global) {
+            uint64_t line = mem_addr.addr / L1_BLOCK_SIZE;
+            auto store = this->find_store(line);
+            if (store) {
+                ++core_->perf_stats_.store_merges;
+            } else {
+                store_buffer_.push_back({line, 0, t, trace->cid, trace->uuid, SimPlatform::instance().cycles()});
+                store = &store_buffer_.back();
+            }
+            for (uint32_t i = 0; i < num_threads_; ++i) {
+                if (!threads.test(i))
+                    continue;
+                auto addr = trace->mem_addrs.at(i).at(0);
+                uint64_t offset = addr.addr % L1_BLOCK_SIZE;
+                store->byte_mask |= ((uint64_t(1) << addr.size) - 1) << offset;
+            }
+            ++core_->perf_stats_.stores_buffered;
+            DT(3, "store-buffer: addr=" << std::hex << mem_addr.addr << std::dec 
+                << ", tid=" << t << ", threads=" << threads.count() << ", " << *trace);
+            continue;
+        }
+
         MemReq mem_req;
         mem_req.addr  = mem_addr.addr;
         mem_req.write = is_write;
@@ -152,6 +321,13 @@ void LsuUnit::tick() {
         mem_req.tag   = tag;
         mem_req.core_id = trace->cid;
         mem_req.uuid = trace->uuid;
+        mem_req.pc = trace->PC;
+        for (uint32_t i = 0; i < num_threads_; ++i) {
+            if (threads.test(i)) {
+                auto addr = trace->mem_addrs.at(i).at(0);
+                mem_req.sector_mask |= sector_mask(addr.addr, addr.size);
+            }
+        }
         
         if (type == AddrType::Shared) {
             core_->shared_mem_->Inputs.at(t).send(mem_req, 2);
@@ -159,12 +335,16 @@ void LsuUnit::tick() {
                 << ", type=" << trace->lsu.type << ", tid=" << t << ", " << *trace);
         } else {            
             dcache_req_port.send(mem_req, 2);
+            ++dcache_reqs;
             DT(3, "dcache-req: addr=" << std::hex << mem_addr.addr << ", tag=" << tag 
-                << ", type=" << trace->lsu.type << ", tid=" << t << ", nc=" << mem_req.non_cacheable << ", " << *trace);
+                << ", type=" << trace->lsu.type << ", tid=" << t << ", nc=" << mem_req.non_cacheable 
+                << ", threads=" << threads.count() << ", " << *trace);
         }        
-        
-        if (is_dup)
-            break;
+    }
+
+    if (dcache_access) {
+        ++core_->perf_stats_.dcache_instrs;
+        core_->perf_stats_.dcache_reqs += dcache_reqs;
     }
 
     // do not wait on writes
@@ -203,7 +383,9 @@ void AluUnit::tick() {
         std::abort();
     }
     DT(3, "pipeline-execute: op=" << trace->alu.type << ", " << *trace);
-    if (trace->fetch_stall) {
+    if (trace->mispredicted) {
+        core_->squash_warp(trace->wid);
+    } else if (trace->fetch_stall) {
         core_->stalled_warps_.reset(trace->wid);
     }
     auto time = Input.pop();
@@ -268,6 +450,16 @@ void GpuUnit::reset() {
     pending_tex_reqs_.clear();
 }
     
+bool GpuUnit::idle() const {
+#ifdef EXT_TEX_ENABLE
+    for (uint32_t t = 0; t < num_threads_; ++t) {
+        if (!core_->dcache_switch_.at(t)->RspOut.at(1).empty())
+            return false;
+    }
+#endif
+    return Input.empty();
+}
+    
 void GpuUnit::tick() {
 #ifdef EXT_TEX_ENABLE
     // handle memory response
@@ -350,6 +542,19 @@ bool GpuUnit::processTexRequest(pipeline_trace_t* trace) {
         trace->resume();
     }
 
+    // check dcache request queues
+    for (uint32_t t = 0; t < num_threads_; ++t) {
+        if (!trace->tmask.test(t))
+            continue;
+        auto& dcache_req_port = core_->dcache_switch_.at(t)->ReqIn.at(1);
+        if (dcache_req_port.available() < trace->mem_addrs.at(t).size()) {
+            if (!trace->suspend()) {
+                DT(3, "*** tex-dcache-stall: tid=" << t << ", " << *trace);
+            }
+            return false;
+        }
+    }
+
     // send memory request
 
     uint32_t valid_addrs = 0;
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <array>
+#include <vector>
 #include <simobject.h>
 #include "pipeline.h"
 #include "cache.h"
@@ -24,6 +26,10 @@ public:
 
     virtual void reset() {}
 
+    virtual bool idle() const {
+        return Input.empty();
+    }
+
     virtual void tick() = 0;
 
 protected:
@@ -43,8 +49,29 @@ public:
 
 class LsuUnit : public ExeUnit {
 private:    
+    // an in-flight load; each request is sent on the port of its first
+    // thread, and port_threads maps that port back to the threads it serves
+    struct pending_req_t {
+        pipeline_trace_t* trace;
+        ThreadMask pending;
+        std::array<ThreadMask, ThreadMask().size()> port_threads;
+    };
+
+    // a cache line holding merged stores, written to the dcache as one
+    // request when it drains
+    struct store_entry_t {
+        uint64_t line;
+        uint64_t byte_mask;     // bytes written
+        uint32_t port;          // dcache port of the first store
+        uint32_t core_id;
+        uint64_t uuid;
+        uint64_t cycle;         // cycle of the first store
+    };
+
     uint32_t num_threads_;
-    HashTable<std::pair<pipeline_trace_t*, uint32_t>> pending_rd_reqs_;
+    HashTable<pending_req_t> pending_rd_reqs_;
+    std::vector<store_entry_t> store_buffer_;   // oldest first
+    bool store_flush_;
     pipeline_trace_t* fence_state_;
     bool fence_lock_;
 
@@ -53,7 +80,23 @@ public:
 
     void reset();
 
+    bool idle() const override;
+
+    bool stores_buffered() const {
+        return !store_buffer_.empty();
+    }
+
     void tick();
+
+private:
+
+    // marks the threads served by the response on port t
+    void complete(uint32_t tag, uint32_t t);
+
+    store_entry_t* find_store(uint64_t line);
+
+    // writes aged lines to the dcache, or all of them during a flush
+    void drain_stores();
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -96,6 +139,8 @@ public:
     GpuUnit(const SimContext& ctx, Core*);
 
     void reset();
+
+    bool idle() const override;
     
     void tick();
 };
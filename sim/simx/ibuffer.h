@@ -1,13 +1,13 @@
 #pragma once
 
 #include "pipeline.h"
-#include <queue>
+#include <ringbuffer.h>
 
 namespace vortex {
 
 class IBuffer {
 private:
-    std::queue<pipeline_trace_t*> entries_;
+    RingBuffer<pipeline_trace_t*> entries_;
     uint32_t capacity_;
 
 public:    
@@ -28,7 +28,7 @@ public:
     }
 
     void push(pipeline_trace_t* trace) {
-        entries_.emplace(trace);
+        entries_.push(trace);
     }
 
     void pop() {
@@ -36,8 +36,7 @@ public:
     }
 
     void clear() {
-        std::queue<pipeline_trace_t*> empty;
-        std::swap(entries_, empty );
+        entries_.clear();
     }
 };
 
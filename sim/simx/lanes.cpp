@@ -0,0 +1,339 @@
+#include "lanes.h"
+#include <assert.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define LANES_X86
+#endif
+
+using namespace vortex;
+using namespace vortex::lanes;
+
+namespace {
+
+struct impl_t {
+  const char* name;
+  void (*alu)(AluOp, uint32_t*, const uint32_t*, const uint32_t*, uint32_t, uint32_t);
+  void (*alu_imm)(AluOp, uint32_t*, const uint32_t*, uint32_t, uint32_t, uint32_t);
+  void (*fill)(uint32_t*, uint32_t, uint32_t, uint32_t);
+  uint32_t (*cmp)(CmpOp, const uint32_t*, const uint32_t*, uint32_t, uint32_t);
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+void scalar_alu(AluOp op, uint32_t* dst, const uint32_t* a, const uint32_t* b, uint32_t num_lanes, uint32_t tmask) {
+  for (uint32_t t = 0; t < num_lanes; ++t) {
+    if (tmask & (1u << t)) {
+      dst[t] = eval_alu(op, a[t], b[t]);
+    }
+  }
+}
+
+void scalar_alu_imm(AluOp op, uint32_t* dst, const uint32_t* a, uint32_t imm, uint32_t num_lanes, uint32_t tmask) {
+  for (uint32_t t = 0; t < num_lanes; ++t) {
+    if (tmask & (1u << t)) {
+      dst[t] = eval_alu(op, a[t], imm);
+    }
+  }
+}
+
+void scalar_fill(uint32_t* dst, uint32_t value, uint32_t num_lanes, uint32_t tmask) {
+  for (uint32_t t = 0; t < num_lanes; ++t) {
+    if (tmask & (1u << t)) {
+      dst[t] = value;
+    }
+  }
+}
+
+uint32_t scalar_cmp(CmpOp op, const uint32_t* a, const uint32_t* b, uint32_t num_lanes, uint32_t tmask) {
+  uint32_t ret = 0;
+  for (uint32_t t = 0; t < num_lanes; ++t) {
+    if ((tmask & (1u << t)) && eval_cmp(op, a[t], b[t])) {
+      ret |= (1u << t);
+    }
+  }
+  return ret;
+}
+
+const impl_t scalar_impl = {
+  "scalar", scalar_alu, scalar_alu_imm, scalar_fill, scalar_cmp
+};
+
+#ifdef LANES_X86
+
+///////////////////////////////////////////////////////////////////////////////
+
+#define SSE41 __attribute__((target("sse4.1")))
+
+// lanes of a 4-lane group selected by the thread mask
+SSE41 inline __m128i sse_mask(uint32_t bits) {
+  auto sel = _mm_setr_epi32(1, 2, 4, 8);
+  return _mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(bits), sel), sel);
+}
+
+SSE41 inline __m128i sse_sltu(__m128i a, __m128i b) {
+  auto bias = _mm_set1_epi32(int32_t(0x80000000));
+  return _mm_cmplt_epi32(_mm_xor_si128(a, bias), _mm_xor_si128(b, bias));
+}
+
+// variable shifts have no SSE4.1 instruction, they go through memory
+SSE41 inline __m128i sse_eval(AluOp op, __m128i a, __m128i b) {
+  auto one = _mm_set1_epi32(1);
+  switch (op) {
+  case AluOp::ADD:  return _mm_add_epi32(a, b);
+  case AluOp::SUB:  return _mm_sub_epi32(a, b);
+  case AluOp::SLT:  return _mm_and_si128(_mm_cmplt_epi32(a, b), one);
+  case AluOp::SLTU: return _mm_and_si128(sse_sltu(a, b), one);
+  case AluOp::XOR:  return _mm_xor_si128(a, b);
+  case AluOp::OR:   return _mm_or_si128(a, b);
+  case AluOp::AND:  return _mm_and_si128(a, b);
+  case AluOp::MUL:  return _mm_mullo_epi32(a, b);
+  default: {
+    alignas(16) uint32_t va[4], vb[4];
+    _mm_store_si128((__m128i*)va, a);
+    _mm_store_si128((__m128i*)vb, b);
+    for (uint32_t i = 0; i < 4; ++i) {
+      va[i] = eval_alu(op, va[i], vb[i]);
+    }
+    return _mm_load_si128((const __m128i*)va);
+  }
+  }
+}
+
+SSE41 void sse_alu(AluOp op, uint32_t* dst, const uint32_t* a, const uint32_t* b, uint32_t num_lanes, uint32_t tmask) {
+  for (uint32_t t = 0; t < num_lanes; t += 4) {
+    uint32_t bits = (tmask >> t) & 0xf;
+    if (0 == bits)
+      continue;
+    auto va = _mm_load_si128((const __m128i*)(a + t));
+    auto vb = _mm_load_si128((const __m128i*)(b + t));
+    auto vd = _mm_load_si128((const __m128i*)(dst + t));
+    auto vr = sse_eval(op, va, vb);
+    _mm_store_si128((__m128i*)(dst + t), _mm_blendv_epi8(vd, vr, sse_mask(bits)));
+  }
+}
+
+SSE41 void sse_alu_imm(AluOp op, uint32_t* dst, const uint32_t* a, uint32_t imm, uint32_t num_lanes, uint32_t tmask) {
+  auto vb = _mm_set1_epi32(imm);
+  auto count = _mm_cvtsi32_si128(imm & 31);
+  for (uint32_t t = 0; t < num_lanes; t += 4) {
+    uint32_t bits = (tmask >> t) & 0xf;
+    if (0 == bits)
+      continue;
+    auto va = _mm_load_si128((const __m128i*)(a + t));
+    auto vd = _mm_load_si128((const __m128i*)(dst + t));
+    __m128i vr;
+    switch (op) {
+    case AluOp::SLL: vr = _mm_sll_epi32(va, count); break;
+    case AluOp::SRL: vr = _mm_srl_epi32(va, count); break;
+    case AluOp::SRA: vr = _mm_sra_epi32(va, count); break;
+    default:         vr = sse_eval(op, va, vb); break;
+    }
+    _mm_store_si128((__m128i*)(dst + t), _mm_blendv_epi8(vd, vr, sse_mask(bits)));
+  }
+}
+
+SSE41 void sse_fill(uint32_t* dst, uint32_t value, uint32_t num_lanes, uint32_t tmask) {
+  auto vr = _mm_set1_epi32(value);
+  for (uint32_t t = 0; t < num_lanes; t += 4) {
+    uint32_t bits = (tmask >> t) & 0xf;
+    if (0 == bits)
+      continue;
+    auto vd = _mm_load_si128((const __m128i*)(dst + t));
+    _mm_store_si128((__m128i*)(dst + t), _mm_blendv_epi8(vd, vr, sse_mask(bits)));
+  }
+}
+
+SSE41 uint32_t sse_cmp(CmpOp op, const uint32_t* a, const uint32_t* b, uint32_t num_lanes, uint32_t tmask) {
+  uint32_t ret = 0;
+  for (uint32_t t = 0; t < num_lanes; t += 4) {
+    if (0 == ((tmask >> t) & 0xf))
+      continue;
+    auto va = _mm_load_si128((const __m128i*)(a + t));
+    auto vb = _mm_load_si128((const __m128i*)(b + t));
+    __m128i vr;
+    switch (op) {
+    case CmpOp::EQ:  vr = _mm_cmpeq_epi32(va, vb); break;
+    case CmpOp::NE:  vr = _mm_cmpeq_epi32(va, vb); break;
+    case CmpOp::LT:  vr = _mm_cmplt_epi32(va, vb); break;
+    case CmpOp::GE:  vr = _mm_cmplt_epi32(va, vb); break;
+    case CmpOp::LTU: vr = sse_sltu(va, vb); break;
+    case CmpOp::GEU: vr = sse_sltu(va, vb); break;
+    }
+    uint32_t bits = _mm_movemask_ps(_mm_castsi128_ps(vr));
+    if (op == CmpOp::NE || op == CmpOp::GE || op == CmpOp::GEU) {
+      bits ^= 0xf;
+    }
+    ret |= bits << t;
+  }
+  return ret & tmask;
+}
+
+const impl_t sse41_impl = {
+  "sse4.1", sse_alu, sse_alu_imm, sse_fill, sse_cmp
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+#define AVX2 __attribute__((target("avx2")))
+
+// lanes of an 8-lane group selected by the thread mask
+AVX2 inline __m256i avx_mask(uint32_t bits) {
+  auto sel = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+  return _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(bits), sel), sel);
+}
+
+AVX2 inline __m256i avx_sltu(__m256i a, __m256i b) {
+  auto bias = _mm256_set1_epi32(int32_t(0x80000000));
+  return _mm256_cmpgt_epi32(_mm256_xor_si256(b, bias), _mm256_xor_si256(a, bias));
+}
+
+AVX2 inline __m256i avx_eval(AluOp op, __m256i a, __m256i b) {
+  auto one = _mm256_set1_epi32(1);
+  auto shamt = _mm256_and_si256(b, _mm256_set1_epi32(31));
+  switch (op) {
+  case AluOp::ADD:  return _mm256_add_epi32(a, b);
+  case AluOp::SUB:  return _mm256_sub_epi32(a, b);
+  case AluOp::SLL:  return _mm256_sllv_epi32(a, shamt);
+  case AluOp::SLT:  return _mm256_and_si256(_mm256_cmpgt_epi32(b, a), one);
+  case AluOp::SLTU: return _mm256_and_si256(avx_sltu(a, b), one);
+  case AluOp::XOR:  return _mm256_xor_si256(a, b);
+  case AluOp::SRL:  return _mm256_srlv_epi32(a, shamt);
+  case AluOp::SRA:  return _mm256_srav_epi32(a, shamt);
+  case AluOp::OR:   return _mm256_or_si256(a, b);
+  case AluOp::AND:  return _mm256_and_si256(a, b);
+  case AluOp::MUL:  return _mm256_mullo_epi32(a, b);
+  }
+  return a;
+}
+
+AVX2 void avx_alu(AluOp op, uint32_t* dst, const uint32_t* a, const uint32_t* b, uint32_t num_lanes, uint32_t tmask) {
+  for (uint32_t t = 0; t < num_lanes; t += 8) {
+    uint32_t bits = (tmask >> t) & 0xff;
+    if (0 == bits)
+      continue;
+    auto va = _mm256_load_si256((const __m256i*)(a + t));
+    auto vb = _mm256_load_si256((const __m256i*)(b + t));
+    auto vd = _mm256_load_si256((const __m256i*)(dst + t));
+    auto vr = avx_eval(op, va, vb);
+    _mm256_store_si256((__m256i*)(dst + t), _mm256_blendv_epi8(vd, vr, avx_mask(bits)));
+  }
+}
+
+AVX2 void avx_alu_imm(AluOp op, uint32_t* dst, const uint32_t* a, uint32_t imm, uint32_t num_lanes, uint32_t tmask) {
+  auto vb = _mm256_set1_epi32(imm);
+  for (uint32_t t = 0; t < num_lanes; t += 8) {
+    uint32_t bits = (tmask >> t) & 0xff;
+    if (0 == bits)
+      continue;
+    auto va = _mm256_load_si256((const __m256i*)(a + t));
+    auto vd = _mm256_load_si256((const __m256i*)(dst + t));
+    auto vr = avx_eval(op, va, vb);
+    _mm256_store_si256((__m256i*)(dst + t), _mm256_blendv_epi8(vd, vr, avx_mask(bits)));
+  }
+}
+
+AVX2 void avx_fill(uint32_t* dst, uint32_t value, uint32_t num_lanes, uint32_t tmask) {
+  auto vr = _mm256_set1_epi32(value);
+  for (uint32_t t = 0; t < num_lanes; t += 8) {
+    uint32_t bits = (tmask >> t) & 0xff;
+    if (0 == bits)
+      continue;
+    auto vd = _mm256_load_si256((const __m256i*)(dst + t));
+    _mm256_store_si256((__m256i*)(dst + t), _mm256_blendv_epi8(vd, vr, avx_mask(bits)));
+  }
+}
+
+AVX2 uint32_t avx_cmp(CmpOp op, const uint32_t* a, const uint32_t* b, uint32_t num_lanes, uint32_t tmask) {
+  uint32_t ret = 0;
+  for (uint32_t t = 0; t < num_lanes; t += 8) {
+    if (0 == ((tmask >> t) & 0xff))
+      continue;
+    auto va = _mm256_load_si256((const __m256i*)(a + t));
+    auto vb = _mm256_load_si256((const __m256i*)(b + t));
+    __m256i vr;
+    switch (op) {
+    case CmpOp::EQ:  vr = _mm256_cmpeq_epi32(va, vb); break;
+    case CmpOp::NE:  vr = _mm256_cmpeq_epi32(va, vb); break;
+    case CmpOp::LT:  vr = _mm256_cmpgt_epi32(vb, va); break;
+    case CmpOp::GE:  vr = _mm256_cmpgt_epi32(vb, va); break;
+    case CmpOp::LTU: vr = avx_sltu(va, vb); break;
+    case CmpOp::GEU: vr = avx_sltu(va, vb); break;
+    }
+    uint32_t bits = _mm256_movemask_ps(_mm256_castsi256_ps(vr));
+    if (op == CmpOp::NE || op == CmpOp::GE || op == CmpOp::GEU) {
+      bits ^= 0xff;
+    }
+    ret |= bits << t;
+  }
+  return ret & tmask;
+}
+
+const impl_t avx2_impl = {
+  "avx2", avx_alu, avx_alu_imm, avx_fill, avx_cmp
+};
+
+#endif
+
+// implementations in order of preference
+std::vector<const impl_t*> supported_impls() {
+  std::vector<const impl_t*> impls;
+#ifdef LANES_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    impls.push_back(&avx2_impl);
+  if (__builtin_cpu_supports("sse4.1"))
+    impls.push_back(&sse41_impl);
+#endif
+  impls.push_back(&scalar_impl);
+  return impls;
+}
+
+const impl_t* s_impl = supported_impls().front();
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void lanes::alu(AluOp op, uint32_t* dst, const uint32_t* a, const uint32_t* b, uint32_t num_lanes, uint32_t tmask) {
+  assert(0 == (num_lanes % LANE_GROUP));
+  s_impl->alu(op, dst, a, b, num_lanes, tmask);
+}
+
+void lanes::alu_imm(AluOp op, uint32_t* dst, const uint32_t* a, uint32_t imm, uint32_t num_lanes, uint32_t tmask) {
+  assert(0 == (num_lanes % LANE_GROUP));
+  s_impl->alu_imm(op, dst, a, imm, num_lanes, tmask);
+}
+
+void lanes::fill(uint32_t* dst, uint32_t value, uint32_t num_lanes, uint32_t tmask) {
+  assert(0 == (num_lanes % LANE_GROUP));
+  s_impl->fill(dst, value, num_lanes, tmask);
+}
+
+uint32_t lanes::cmp(CmpOp op, const uint32_t* a, const uint32_t* b, uint32_t num_lanes, uint32_t tmask) {
+  assert(0 == (num_lanes % LANE_GROUP));
+  return s_impl->cmp(op, a, b, num_lanes, tmask);
+}
+
+const char* lanes::isa() {
+  return s_impl->name;
+}
+
+std::vector<const char*> lanes::supported_isas() {
+  std::vector<const char*> names;
+  for (auto impl : supported_impls()) {
+    names.push_back(impl->name);
+  }
+  return names;
+}
+
+bool lanes::set_isa(const char* name) {
+  for (auto impl : supported_impls()) {
+    if (0 == strcmp(impl->name, name)) {
+      s_impl = impl;
+      return true;
+    }
+  }
+  return false;
+}
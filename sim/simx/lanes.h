@@ -0,0 +1,102 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <VX_config.h>
+#include "debug.h"
+
+// Lane execution is used for 32-bit registers when source operands are not
+// traced; debug builds printing operands keep the per-thread path.
+#if XLEN == 32 && (defined(NDEBUG) || DEBUG_LEVEL < 2)
+#define EXECUTE_LANES
+#endif
+
+namespace vortex {
+
+// Warp-wide integer operations over register lane arrays.
+// Lane arrays hold a multiple of LANE_GROUP 32-bit elements aligned to
+// LANE_ALIGN bytes. Only lanes selected by the thread mask are written, the
+// others keep their value. The implementation is picked once at startup
+// from AVX2, SSE4.1 and portable scalar code; set_isa() overrides it.
+namespace lanes {
+
+static constexpr uint32_t LANE_GROUP = 8;
+static constexpr uint32_t LANE_ALIGN = 32;
+
+enum class AluOp {
+  ADD,
+  SUB,
+  SLL,
+  SLT,
+  SLTU,
+  XOR,
+  SRL,
+  SRA,
+  OR,
+  AND,
+  MUL
+};
+
+enum class CmpOp {
+  EQ,
+  NE,
+  LT,
+  GE,
+  LTU,
+  GEU
+};
+
+// reference result of a single lane
+inline uint32_t eval_alu(AluOp op, uint32_t a, uint32_t b) {
+  switch (op) {
+  case AluOp::ADD:  return a + b;
+  case AluOp::SUB:  return a - b;
+  case AluOp::SLL:  return a << (b & 31);
+  case AluOp::SLT:  return int32_t(a) < int32_t(b);
+  case AluOp::SLTU: return a < b;
+  case AluOp::XOR:  return a ^ b;
+  case AluOp::SRL:  return a >> (b & 31);
+  case AluOp::SRA:  return int32_t(a) >> (b & 31);
+  case AluOp::OR:   return a | b;
+  case AluOp::AND:  return a & b;
+  case AluOp::MUL:  return a * b;
+  }
+  return 0;
+}
+
+inline bool eval_cmp(CmpOp op, uint32_t a, uint32_t b) {
+  switch (op) {
+  case CmpOp::EQ:  return a == b;
+  case CmpOp::NE:  return a != b;
+  case CmpOp::LT:  return int32_t(a) < int32_t(b);
+  case CmpOp::GE:  return int32_t(a) >= int32_t(b);
+  case CmpOp::LTU: return a < b;
+  case CmpOp::GEU: return a >= b;
+  }
+  return false;
+}
+
+// dst[t] = a[t] op b[t]
+void alu(AluOp op, uint32_t* dst, const uint32_t* a, const uint32_t* b, uint32_t num_lanes, uint32_t tmask);
+
+// dst[t] = a[t] op imm
+void alu_imm(AluOp op, uint32_t* dst, const uint32_t* a, uint32_t imm, uint32_t num_lanes, uint32_t tmask);
+
+// dst[t] = value
+void fill(uint32_t* dst, uint32_t value, uint32_t num_lanes, uint32_t tmask);
+
+// mask of the lanes where a[t] op b[t] holds
+uint32_t cmp(CmpOp op, const uint32_t* a, const uint32_t* b, uint32_t num_lanes, uint32_t tmask);
+
+// name of the selected implementation
+const char* isa();
+
+// names of the implementations this host can run
+std::vector<const char*> supported_isas();
+
+// selects the named implementation, fails if the host cannot run it
+bool set_isa(const char* name);
+
+}
+
+}
@@ -12,6 +12,7 @@
 #include <util.h>
 #include "args.h"
 #include "core.h"
+#include <checkpoint.h>
 
 using namespace vortex;
 
@@ -22,9 +23,20 @@ int main(int argc, char **argv) {
   int num_cores(NUM_CORES * NUM_CLUSTERS);
   int num_warps(NUM_WARPS);
   int num_threads(NUM_THREADS);  
+  int num_jobs(1);
+  std::string saveCkptFileName;
+  std::string loadCkptFileName;
+  uint64_t ckpt_cycle(0);
   bool showHelp(false);
   bool showStats(false);
   bool riscv_test(false);
+  bool functional(false);
+  bool profile(false);
+  uint64_t sample_period(0);
+  uint64_t sample_warmup(10000);
+  uint64_t sample_window(10000);
+  std::string warp_policy("rr");
+  std::string branch_policy("none");
 
   // parse the command line arguments
   CommandLineArgFlag fh("-h", "--help", "show command line options", showHelp);
@@ -32,23 +44,45 @@ int main(int argc, char **argv) {
   CommandLineArgSetter<int> fc("-c", "--cores", "number of cores", num_cores);
   CommandLineArgSetter<int> fw("-w", "--warps", "number  of warps", num_warps);
   CommandLineArgSetter<int> ft("-t", "--threads", "number of threads", num_threads);
+  CommandLineArgSetter<int> fj("-j", "--jobs", "number of host threads", num_jobs);
   CommandLineArgFlag fr("-r", "--riscv", "enable riscv tests", riscv_test);
   CommandLineArgFlag fs("-s", "--stats", "show stats", showStats);
+  CommandLineArgFlag ff("--functional", "functional simulation only", functional);
+  CommandLineArgFlag fp("--profile", "host time profile", profile);
+  CommandLineArgSetter<uint64_t> fsp("--sample-period", "fast-forwarded instructions per sample", sample_period);
+  CommandLineArgSetter<uint64_t> fsu("--sample-warmup", "warmup cycles per sample", sample_warmup);
+  CommandLineArgSetter<uint64_t> fsw("--sample-window", "measured cycles per sample", sample_window);
+  CommandLineArgSetter<std::string> fwp("--warp-policy", "warp scheduling policy", warp_policy);
+  CommandLineArgSetter<std::string> fbp("--branch-predictor", "branch prediction policy", branch_policy);
+  CommandLineArgSetter<std::string> fcs("--save-checkpoint", "checkpoint output file", saveCkptFileName);
+  CommandLineArgSetter<uint64_t> fcc("--checkpoint-cycle", "checkpoint cycle", ckpt_cycle);
+  CommandLineArgSetter<std::string> fcl("--load-checkpoint", "checkpoint input file", loadCkptFileName);
 
   CommandLineArg::readArgs(argc - 1, argv + 1);
 
-  if (showHelp || imgFileName.empty()) {
+  if (showHelp || (imgFileName.empty() && loadCkptFileName.empty())) {
     std::cout << "Vortex emulator command line arguments:\n"
                  "  -i, --image <filename> Program RAM image\n"
                  "  -c, --cores <num> Number of cores\n"
                  "  -w, --warps <num> Number of warps\n"
                  "  -t, --threads <num> Number of threads\n"
+                 "  -j, --jobs <num> Number of host simulation threads\n"
                  "  -r, --riscv riscv test\n"
-                 "  -s, --stats Print stats on exit.\n";
+                 "  -s, --stats Print stats on exit.\n"
+                 "  --functional Execute instructions without the timing model\n"
+                 "  --profile Print the host time spent per component on exit\n"
+                 "  --sample-period <num> Sampled simulation, instructions fast-forwarded between samples\n"
+                 "  --sample-warmup <num> Detailed cycles before each sample (default 10000)\n"
+                 "  --sample-window <num> Detailed cycles measured per sample (default 10000)\n"
+                 "  --warp-policy <name> Warp scheduling policy: rr, gto, two-level or locality (default rr)\n"
+                 "  --branch-predictor <name> Branch prediction: none, not-taken or btb (default none)\n"
+                 "  --save-checkpoint <filename> Save a checkpoint during the run\n"
+                 "  --checkpoint-cycle <num> Cycle at which the checkpoint is taken\n"
+                 "  --load-checkpoint <filename> Resume from a checkpoint\n";
     return 0;
   }
 
-  std::cout << "Running " << imgFileName << "..." << std::endl;
+  std::cout << "Running " << (imgFileName.empty() ? loadCkptFileName : imgFileName) << "..." << std::endl;
   
   {
     // create processor configuation
@@ -58,7 +92,7 @@ int main(int argc, char **argv) {
     RAM ram(RAM_PAGE_SIZE);
 
     // load program
-    {
+    if (!imgFileName.empty()) {
       std::string program_ext(fileExtension(imgFileName.c_str()));
       if (program_ext == "bin") {
         ram.loadBinImage(imgFileName.c_str(), STARTUP_ADDR);
@@ -76,8 +110,38 @@ int main(int argc, char **argv) {
     // attach memory module
     processor.attach_ram(&ram);   
 
+    // distribute cores across host threads
+    processor.set_num_threads(num_jobs);
+
+    // skip the timing model
+    processor.set_functional(functional);
+    processor.set_sampling(sample_period, sample_warmup, sample_window);
+    processor.set_profiling(profile);
+    processor.set_show_stats(showStats);
+    if (!processor.set_warp_policy(warp_policy.c_str())) {
+      std::cout << "*** error: unknown warp policy " << warp_policy << std::endl;
+      return -1;
+    }
+    if (!processor.set_branch_policy(branch_policy.c_str())) {
+      std::cout << "*** error: unknown branch predictor " << branch_policy << std::endl;
+      return -1;
+    }
+
+    // setup checkpointing
+    if (!saveCkptFileName.empty()) {
+      processor.save_checkpoint(saveCkptFileName.c_str(), ckpt_cycle);
+    }
+    if (!loadCkptFileName.empty()) {
+      processor.restore_checkpoint(loadCkptFileName.c_str());
+    }
+
     // run simulation
-    exitcode = processor.run();
+    try {
+      exitcode = processor.run();
+    } catch (const CheckpointError& e) {
+      std::cout << "*** error: " << e.what() << std::endl;
+      return -1;
+    }
 
   } 
 
@@ -1,6 +1,7 @@
 #include "memsim.h"
 #include <vector>
 #include <queue>
+#include <bitset>
 #include <stdlib.h>
 
 DISABLE_WARNING_PUSH
@@ -23,6 +24,8 @@ private:
     Config config_;
     PerfStats perf_stats_;
     ramulator::Gem5Wrapper* dram_;
+    uint64_t pending_reads_;
+    uint64_t dram_cycle_;
 
 public:
 
@@ -55,23 +58,43 @@ public:
     void dram_callback(ramulator::Request& req, uint32_t tag, uint64_t uuid) {
         if (req.type == ramulator::Request::Type::WRITE)
             return;
+        --pending_reads_;
         MemRsp mem_rsp{tag, (uint32_t)req.coreid, uuid};
-        simobject_->MemRspPort.send(mem_rsp, 1);
+        // the DRAM clock may run ahead of the platform during advance()
+        uint64_t delay = dram_cycle_ + 1 - SimPlatform::instance().cycles();
+        simobject_->MemRspPort.send(mem_rsp, delay);
         DT(3, simobject_->name() << "-" << mem_rsp);
     }
 
     void reset() {
         perf_stats_ = PerfStats();
+        pending_reads_ = 0;
+        dram_cycle_ = SimPlatform::instance().cycles();
+    }
+
+    bool idle() const {
+        // the DRAM clock is caught up on the next tick; this is exact 
+        // only while no read callback can fire in the skipped cycles.
+        return (0 == pending_reads_) && simobject_->MemReqPort.empty();
+    }
+
+    bool can_advance() const {
+        // queued reads complete without further input
+        return simobject_->MemReqPort.empty();
+    }
+
+    void advance(uint64_t until) {
+        // run the DRAM clock ahead, up to the first completed read
+        auto pending_reads = pending_reads_;
+        while (dram_cycle_ < until && pending_reads_ == pending_reads) {
+            this->dram_tick();
+        }
     }
 
     void tick() {
-        if (MEM_CYCLE_RATIO > 0) { 
-            auto cycle = SimPlatform::instance().cycles();
-            if ((cycle % MEM_CYCLE_RATIO) == 0)
-                dram_->tick();
-        } else {
-            for (int i = MEM_CYCLE_RATIO; i <= 0; ++i)
-                dram_->tick();            
+        auto cycle = SimPlatform::instance().cycles();
+        while (dram_cycle_ <= cycle) {
+            this->dram_tick();
         }
               
         if (simobject_->MemReqPort.empty())
@@ -89,16 +112,35 @@ public:
         if (!dram_->send(dram_req))
             return;
         
+        // DRAM bursts stay whole blocks, the sector mask only sizes the transfer
+        uint64_t bytes = mem_req.sector_mask ? (std::bitset<64>(mem_req.sector_mask).count() * MEM_SECTOR_SIZE) : MEM_BLOCK_SIZE;
         if (mem_req.write) {
             ++perf_stats_.writes;
+            perf_stats_.bytes_written += bytes;
         } else {
             ++perf_stats_.reads;
+            perf_stats_.bytes_read += bytes;
+            ++pending_reads_;
         }
         
         DT(3, simobject_->name() << "-" << mem_req);
 
         simobject_->MemReqPort.pop();        
     }
+
+private:
+
+    // one simulation cycle of the DRAM clock
+    void dram_tick() {
+        if (MEM_CYCLE_RATIO > 0) { 
+            if ((dram_cycle_ % MEM_CYCLE_RATIO) == 0)
+                dram_->tick();
+        } else {
+            for (int i = MEM_CYCLE_RATIO; i <= 0; ++i)
+                dram_->tick();            
+        }
+        ++dram_cycle_;
+    }
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -118,6 +160,22 @@ void MemSim::reset() {
     impl_->reset();
 }
 
+bool MemSim::idle() const {
+    return impl_->idle();
+}
+
+bool MemSim::can_advance() const {
+    return impl_->can_advance();
+}
+
+void MemSim::advance(uint64_t until) {
+    impl_->advance(until);
+}
+
 void MemSim::tick() {
     impl_->tick();
-}
\ No newline at end of file
+}
+
+const MemSim::PerfStats& MemSim::perf_stats() const {
+    return impl_->perf_stats();
+}
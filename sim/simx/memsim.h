@@ -16,10 +16,14 @@ public:
     struct PerfStats {
         uint64_t reads;
         uint64_t writes;
+        uint64_t bytes_read;
+        uint64_t bytes_written;
 
         PerfStats() 
             : reads(0)
             , writes(0)
+            , bytes_read(0)
+            , bytes_written(0)
         {}
     };
 
@@ -31,6 +35,12 @@ public:
 
     void reset();
 
+    bool idle() const;
+
+    bool can_advance() const;
+
+    void advance(uint64_t until);
+
     void tick();
 
     const PerfStats& perf_stats() const;
@@ -4,6 +4,7 @@
 #include <memory>
 #include <iostream>
 #include <util.h>
+#include <ringbuffer.h>
 #include "types.h"
 #include "archdef.h"
 #include "debug.h"
@@ -22,6 +23,11 @@ struct pipeline_trace_t {
 
   //--
   bool        fetch_stall;
+  bool        mispredicted;
+
+  //--
+  bool        wrong_path;
+  uint32_t    squash_epoch;
 
   //--
   bool        wb;  
@@ -37,7 +43,7 @@ struct pipeline_trace_t {
   ExeType     exe_type; 
 
   //--
-  std::vector<std::vector<mem_addr_size_t>> mem_addrs;
+  FixedVector<ThreadMemAddrs, ThreadMask().size()> mem_addrs;
   
   //--
   union {
@@ -58,13 +64,25 @@ struct pipeline_trace_t {
 
   bool stalled;
 
+  //--
+  uint64_t    issue_cycle;
+
   pipeline_trace_t(uint64_t uuid_, const ArchDef& arch) {
+    mem_addrs.resize(arch.num_threads());
+    this->reset(uuid_);
+  }
+
+  // reinitialize for a new instruction, keeping the address buffers
+  void reset(uint64_t uuid_) {
     uuid = uuid_;
     cid = 0;
     wid = 0;
     tmask.reset();
     PC = 0;
     fetch_stall = false;
+    mispredicted = false;
+    wrong_path = false;
+    squash_epoch = 0;
     wb  = false;
     rdest = 0;
     rdest_type = RegType::None;
@@ -72,8 +90,11 @@ struct pipeline_trace_t {
     used_fregs.reset();
     used_vregs.reset();
     exe_type = ExeType::NOP;
-    mem_addrs.resize(arch.num_threads());
+    for (auto& addrs : mem_addrs) {
+      addrs.clear();
+    }
     stalled = false;
+    issue_cycle = 0;
   }
 
   bool suspend() {
@@ -87,6 +108,32 @@ struct pipeline_trace_t {
   }
 };
 
+// Traces owned by a core, recycled once committed.
+class PipelineTracePool {
+public:
+  PipelineTracePool(const ArchDef& arch) : arch_(arch) {}
+
+  pipeline_trace_t* allocate(uint64_t uuid) {
+    if (free_.empty()) {
+      traces_.emplace_back(new pipeline_trace_t(uuid, arch_));
+      return traces_.back().get();
+    }
+    auto trace = free_.back();
+    free_.pop_back();
+    trace->reset(uuid);
+    return trace;
+  }
+
+  void release(pipeline_trace_t* trace) {
+    free_.push_back(trace);
+  }
+
+private:
+  const ArchDef& arch_;
+  std::vector<std::unique_ptr<pipeline_trace_t>> traces_;
+  std::vector<pipeline_trace_t*> free_;
+};
+
 inline std::ostream &operator<<(std::ostream &os, const pipeline_trace_t& state) {
   os << "coreid=" << state.cid << ", wid=" << state.wid << ", PC=" << std::hex << state.PC;
   os << ", wb=" << state.wb;
@@ -94,6 +141,9 @@ inline std::ostream &operator<<(std::ostream &os, const pipeline_trace_t& state)
      os << ", rd=" << state.rdest_type << std::dec << state.rdest;
   }
   os << ", ex=" << state.exe_type;
+  if (state.wrong_path) {
+    os << ", wrong-path";
+  }
   os << " (#" << std::dec << state.uuid << ")";
   return os;
 }
@@ -101,7 +151,7 @@ inline std::ostream &operator<<(std::ostream &os, const pipeline_trace_t& state)
 class PipelineLatch {
 protected:
   const char* name_;
-  std::queue<pipeline_trace_t*> queue_;
+  RingBuffer<pipeline_trace_t*> queue_;
 
 public:
   PipelineLatch(const char* name = nullptr) 
@@ -116,6 +166,10 @@ public:
     return queue_.front();
   }
 
+  pipeline_trace_t* front() const {
+    return queue_.front();
+  }
+
   pipeline_trace_t* back() {
     return queue_.back();
   }
@@ -129,8 +183,7 @@ public:
   }
 
   void clear() {
-    std::queue<pipeline_trace_t*> empty;
-    std::swap(queue_, empty );
+    queue_.clear();
   }
 };
 
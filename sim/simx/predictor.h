@@ -0,0 +1,164 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <assert.h>
+#include <checkpoint.h>
+#include "types.h"
+#include "archdef.h"
+
+namespace vortex {
+
+enum class BranchPolicy {
+    NONE,       // stall the warp on every control instruction
+    NOT_TAKEN,  // fetch the fall-through path
+    BTB,        // per-warp branch target buffer with 2-bit counters
+};
+
+inline const char* branch_policy_name(BranchPolicy policy) {
+    switch (policy) {
+    case BranchPolicy::NONE:      return "none";
+    case BranchPolicy::NOT_TAKEN: return "not-taken";
+    case BranchPolicy::BTB:       return "btb";
+    }
+    return "";
+}
+
+inline bool parse_branch_policy(const std::string& name, BranchPolicy* policy) {
+    for (auto p : {BranchPolicy::NONE, BranchPolicy::NOT_TAKEN, BranchPolicy::BTB}) {
+        if (name == branch_policy_name(p)) {
+            *policy = p;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Predicts the next PC of control instructions.
+// The warp keeps fetching from the predicted PC. On a misprediction the
+// core fetches down the wrong path until the branch resolves in the ALU,
+// then squashes those instructions and holds the warp for
+// BRANCH_MISPREDICT_PENALTY cycles before it refetches.
+class BranchPredictor {
+public:
+    struct PerfStats {
+        uint64_t branches;      // control instructions predicted
+        uint64_t taken;         // taken control instructions
+        uint64_t mispredicts;   // wrong next PC
+
+        PerfStats()
+            : branches(0)
+            , taken(0)
+            , mispredicts(0)
+        {}
+    };
+
+    static constexpr uint32_t MAX_COUNTER = 3;
+
+    BranchPredictor(const ArchDef& arch, uint32_t btb_size)
+        : policy_(BranchPolicy::NONE)
+        , btb_size_(btb_size)
+        , btb_(arch.num_warps() * btb_size)
+    {
+        this->clear();
+    }
+
+    void set_policy(BranchPolicy policy) {
+        policy_ = policy;
+    }
+
+    BranchPolicy policy() const {
+        return policy_;
+    }
+
+    void clear() {
+        for (auto& entry : btb_) {
+            entry = btb_entry_t();
+        }
+        perf_stats_ = PerfStats();
+    }
+
+    // returns false when the warp has to stall until the instruction
+    // resolves, otherwise the PC to keep fetching from
+    bool predict(uint32_t wid, Word pc, Word next_pc, Word* predicted_pc) {
+        Word fall_through = pc + 4;
+        bool taken = (next_pc != fall_through);
+
+        ++perf_stats_.branches;
+        perf_stats_.taken += taken;
+
+        Word predicted = fall_through;
+        switch (policy_) {
+        case BranchPolicy::NONE:
+            return false;
+        case BranchPolicy::NOT_TAKEN:
+            break;
+        case BranchPolicy::BTB:
+            if (btb_size_ != 0) {
+                auto& entry = btb_.at(wid * btb_size_ + (pc >> 2) % btb_size_);
+                if (entry.valid && entry.pc == pc) {
+                    if (entry.counter >= 2) {
+                        predicted = entry.target;
+                    }
+                    if (taken) {
+                        entry.counter += (entry.counter < MAX_COUNTER);
+                        entry.target = next_pc;
+                    } else {
+                        entry.counter -= (entry.counter > 0);
+                    }
+                } else if (taken) {
+                    // allocate taken branches as weakly taken
+                    entry.valid   = true;
+                    entry.pc      = pc;
+                    entry.target  = next_pc;
+                    entry.counter = 2;
+                }
+            }
+            break;
+        }
+
+        if (predicted != next_pc) {
+            ++perf_stats_.mispredicts;
+        }
+        *predicted_pc = predicted;
+        return true;
+    }
+
+    const PerfStats& perf_stats() const {
+        return perf_stats_;
+    }
+
+    void save(CheckpointWriter& writer) const {
+        writer.write(btb_);
+    }
+
+    void restore(CheckpointReader& reader) {
+        reader.expect<uint32_t>(btb_.size(), "btb size");
+        for (auto& entry : btb_) {
+            reader.read(&entry);
+        }
+    }
+
+private:
+
+    struct btb_entry_t {
+        bool     valid;
+        uint32_t counter;
+        Word     pc;
+        Word     target;
+
+        btb_entry_t()
+            : valid(false)
+            , counter(0)
+            , pc(0)
+            , target(0)
+        {}
+    };
+
+    BranchPolicy policy_;
+    uint32_t btb_size_;
+    std::vector<btb_entry_t> btb_;
+    PerfStats perf_stats_;
+};
+
+}
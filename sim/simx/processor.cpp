@@ -1,9 +1,20 @@
 #include "processor.h"
+#include <fstream>
+#include <chrono>
+#include <array>
+#include <cmath>
+#include <checkpoint.h>
 #include "core.h"
 #include "constants.h"
 
 using namespace vortex;
 
+static constexpr uint32_t NUM_STALLS = 7;
+
+static const char* stall_names[NUM_STALLS] = {
+  "ibuffer", "scoreboard", "alu", "lsu", "csr", "fpu", "gpu"
+};
+
 class Processor::Impl {
 private:
   std::vector<Core::Ptr> cores_;
@@ -11,38 +22,61 @@ private:
   std::vector<Switch<MemReq, MemRsp>::Ptr> l2_mem_switches_;
   Cache::Ptr l3cache_;
   Switch<MemReq, MemRsp>::Ptr l3_mem_switch_;
+  MemSim::Ptr memsim_;
+  const ArchDef arch_;
+  RAM* ram_;
+  std::string save_file_;
+  uint64_t save_cycle_;
+  std::string restore_file_;
+  bool functional_;
+  uint64_t sample_period_;
+  uint64_t sample_warmup_;
+  uint64_t sample_window_;
+  double sample_cpi_;
+  bool show_stats_;
 
 public:
   Impl(const ArchDef& arch) 
     : cores_(arch.num_cores())
     , l2caches_(NUM_CLUSTERS)
     , l2_mem_switches_(NUM_CLUSTERS)
+    , arch_(arch)
+    , ram_(nullptr)
+    , save_cycle_(0)
+    , functional_(false)
+    , sample_period_(0)
+    , sample_warmup_(0)
+    , sample_window_(0)
+    , sample_cpi_(0)
+    , show_stats_(false)
   {
     SimPlatform::instance().initialize();
 
     uint32_t num_cores = arch.num_cores();
     uint32_t cores_per_cluster = num_cores / NUM_CLUSTERS;
 
-    // create cores
+    // create cores, one simulation shard each
     for (uint32_t i = 0; i < num_cores; ++i) {
+        SimPlatform::instance().begin_shard(i);
         cores_.at(i) = Core::Create(arch, i);
+        SimPlatform::instance().end_shard();
     }
 
      // setup memory simulator
-    auto memsim = MemSim::Create("dram", MemSim::Config{
+    memsim_ = MemSim::Create("dram", MemSim::Config{
       MEMORY_BANKS,
       arch.num_cores()
     });
     
-    std::vector<SimPort<MemReq>*> mem_req_ports(1, &memsim->MemReqPort);
-    std::vector<SimPort<MemRsp>*> mem_rsp_ports(1, &memsim->MemRspPort);
+    std::vector<SimPort<MemReq>*> mem_req_ports(1, &memsim_->MemReqPort);
+    std::vector<SimPort<MemRsp>*> mem_rsp_ports(1, &memsim_->MemRspPort);
 
     if (L3_ENABLE) {
       l3cache_ = Cache::Create("l3cache", Cache::Config{
         log2ceil(L3_CACHE_SIZE),  // C
         log2ceil(MEM_BLOCK_SIZE), // B
         2,                      // W
-        0,                      // A
+        log2ceil(L3_NUM_WAYS),  // A
         32,                     // address bits  
         L3_NUM_BANKS,           // number of banks
         L3_NUM_PORTS,           // number of ports
@@ -50,8 +84,18 @@ public:
         true,                   // write-through
         false,                  // write response
         0,                      // victim size
+        0,                      // victim latency
         L3_MSHR_SIZE,           // mshr
         2,                      // pipeline latency
+        0,                      // request queue size
+        0,                      // prefetch table size
+        0,                      // prefetch degree
+        0,                      // next-line prefetch
+        false,                  // direct fill
+        (ReplPolicy)L3_REPL_POLICY, // replacement policy
+        IndexHash::None,        // bank hash
+        IndexHash::None,        // set hash
+        L3_SECTORED,            // sectored
         }
       );        
       l3cache_->MemReqPort.bind(mem_req_ports.at(0));
@@ -88,7 +132,7 @@ public:
           log2ceil(L2_CACHE_SIZE),  // C
           log2ceil(MEM_BLOCK_SIZE), // B
           2,                      // W
-          0,                      // A
+          log2ceil(L2_NUM_WAYS),  // A
           32,                     // address bits  
           L2_NUM_BANKS,           // number of banks
           L2_NUM_PORTS,           // number of ports
@@ -96,8 +140,18 @@ public:
           true,                   // write-through
           false,                  // write response
           0,                      // victim size
+          0,                      // victim latency
           L2_MSHR_SIZE,           // mshr
           2,                      // pipeline latency
+          0,                      // request queue size
+          0,                      // prefetch table size
+          0,                      // prefetch degree
+          0,                      // next-line prefetch
+          false,                  // direct fill
+          (ReplPolicy)L2_REPL_POLICY, // replacement policy
+          IndexHash::None,        // bank hash
+          IndexHash::None,        // set hash
+          L2_SECTORED,            // sectored
         });
         l2cache->MemReqPort.bind(mem_req_ports.at(i));
         mem_rsp_ports.at(i)->bind(&l2cache->MemRspPort);
@@ -127,6 +181,7 @@ public:
   }
 
   ~Impl() {
+    SimPlatform::instance().dump_profile(std::cout);
     SimPlatform::instance().finalize();
   }
 
@@ -134,17 +189,106 @@ public:
     for (auto core : cores_) {
       core->attach_ram(ram);
     }
+    ram_ = ram;
+  }
+
+  void save_checkpoint(const std::string& filename, uint64_t cycle) {
+    save_file_ = filename;
+    save_cycle_ = cycle;
+  }
+
+  void restore_checkpoint(const std::string& filename) {
+    restore_file_ = filename;
+  }
+
+  void set_num_threads(uint32_t num_threads) {
+    SimPlatform::instance().set_num_threads(num_threads);
+  }
+
+  void set_functional(bool enable) {
+    functional_ = enable;
+  }
+
+  void set_profiling(bool enable) {
+    SimPlatform::instance().enable_profiling(enable);
+  }
+
+  bool set_warp_policy(const char* name) {
+    WarpPolicy policy;
+    if (!parse_warp_policy(name, &policy))
+      return false;
+    for (auto& core : cores_) {
+      core->set_warp_policy(policy);
+    }
+    return true;
+  }
+
+  bool set_branch_policy(const char* name) {
+    BranchPolicy policy;
+    if (!parse_branch_policy(name, &policy))
+      return false;
+    for (auto& core : cores_) {
+      core->set_branch_policy(policy);
+    }
+    return true;
+  }
+
+  void set_show_stats(bool enable) {
+    show_stats_ = enable;
+  }
+
+  void set_sampling(uint64_t period, uint64_t warmup, uint64_t window) {
+    sample_period_ = period;
+    sample_warmup_ = warmup;
+    sample_window_ = window;
   }
 
   int run() {
-    SimPlatform::instance().reset();
+    if (!restore_file_.empty()) {
+      this->restore(restore_file_);
+    } else {
+      SimPlatform::instance().reset();
+    }
+    // cores simulated on several host threads share the RAM
+    ram_->set_thread_safe(SimPlatform::instance().num_threads() > 1);
+    if (functional_)
+      return this->run_functional();
+    int exitcode;
+    if (sample_period_ != 0) {
+      exitcode = this->run_sampled();
+    } else {
+      exitcode = this->run_detailed();
+    }
+    if (show_stats_) {
+      this->dump_stats(std::cout);
+    }
+    return exitcode;
+  }
+
+  int run_detailed() {
+    bool saving = !save_file_.empty();
     bool running;
     int exitcode = 0;
     do {
       SimPlatform::instance().tick();
       running = false;
+      if (saving && SimPlatform::instance().cycles() >= save_cycle_) {
+        // drain the machine first, so that no transient state is left
+        for (auto& core : cores_) {
+          core->drain(true);
+        }
+        if (SimPlatform::instance().idle()) {
+          this->save(save_file_);
+          for (auto& core : cores_) {
+            core->drain(false);
+          }
+          saving = false;
+          running = true;
+        }
+      }
       for (auto& core : cores_) {
-        if (core->running()) {
+        // drained cores wait for the checkpoint until the program ends
+        if (core->running() || (saving && core->active())) {
           running = true;
         }
         if (core->check_exit()) {
@@ -155,9 +299,405 @@ public:
       }
     } while (running);
 
+    // an exiting program may leave stores in flight
+    this->flush_stores();
+
+    if (saving) {
+      std::cout << "*** warning: program ended at cycle " << SimPlatform::instance().cycles()
+                << ", no checkpoint saved (checkpoint cycle " << save_cycle_ << ")" << std::endl;
+    }
+
     return exitcode;
   }
 
+  int run_functional() {
+    auto start = std::chrono::steady_clock::now();
+    uint64_t instrs = 0;
+    int exitcode = 0;
+    this->fast_forward(UINT64_MAX, &instrs, &exitcode);
+    auto end = std::chrono::steady_clock::now();
+
+    double elapsed = std::chrono::duration<double>(end - start).count();
+    std::cout << std::dec << "functional: instrs=" << instrs
+              << ", elapsed=" << elapsed << "s"
+              << ", IPS=" << uint64_t(instrs / std::max(elapsed, 1e-9)) << std::endl;
+
+    return exitcode;
+  }
+
+  int run_sampled() {
+    // per-instruction counters of one measurement window
+    struct sample_t {
+      double cpi;
+      std::array<double, NUM_STALLS> stalls;
+    };
+    std::vector<sample_t> samples;
+    uint64_t ff_instrs = 0;
+    sample_cpi_ = 0;
+    int exitcode = 0;
+
+    for (;;) {
+      // skip ahead functionally
+      if (!this->fast_forward(sample_period_, &ff_instrs, &exitcode))
+        break;
+
+      // warm up the caches, then measure
+      if (!this->tick_detailed(sample_warmup_, &exitcode))
+        break;
+      auto counters = this->counters();
+      auto cycles = SimPlatform::instance().cycles();
+      if (!this->tick_detailed(sample_window_, &exitcode))
+        break;
+      auto delta = this->counters();
+      for (uint32_t i = 0; i < delta.size(); ++i) {
+        delta.at(i) -= counters.at(i);
+      }
+      if (delta.at(0) != 0) {
+        sample_t sample;
+        sample.cpi = double(SimPlatform::instance().cycles() - cycles) / delta.at(0);
+        for (uint32_t i = 0; i < NUM_STALLS; ++i) {
+          sample.stalls.at(i) = double(delta.at(i + 1)) / delta.at(0);
+        }
+        samples.push_back(sample);
+      }
+
+      // let in-flight instructions complete before skipping ahead again
+      if (!this->drain(&exitcode))
+        break;
+    }
+
+    uint64_t instrs = this->counters().at(0);
+    std::cout << std::dec << "sampling: samples=" << samples.size()
+              << ", instrs=" << instrs
+              << ", fast-forwarded=" << ff_instrs
+              << ", detailed cycles=" << SimPlatform::instance().cycles() << std::endl;
+    if (samples.empty())
+      return exitcode;
+
+    // mean CPI with a 95% confidence interval (normal approximation)
+    double cpi = 0;
+    std::array<double, NUM_STALLS> stalls{};
+    for (auto& sample : samples) {
+      cpi += sample.cpi;
+      for (uint32_t i = 0; i < NUM_STALLS; ++i) {
+        stalls.at(i) += sample.stalls.at(i);
+      }
+    }
+    uint32_t n = samples.size();
+    cpi /= n;
+    sample_cpi_ = cpi;
+    double var = 0;
+    for (auto& sample : samples) {
+      var += (sample.cpi - cpi) * (sample.cpi - cpi);
+    }
+    double ci = (n > 1) ? 1.96 * std::sqrt(var / (n - 1) / n) : 0;
+
+    std::cout << "sampling: CPI=" << cpi << " +/- " << ci << " (95%)"
+              << ", IPC=" << (1 / cpi)
+              << ", estimated cycles=" << uint64_t(instrs * cpi) << std::endl;
+    std::cout << "sampling: estimated stalls:";
+    for (uint32_t i = 0; i < NUM_STALLS; ++i) {
+      std::cout << " " << stall_names[i] << "=" << uint64_t(instrs * stalls.at(i) / n);
+    }
+    std::cout << std::endl;
+
+    return exitcode;
+  }
+
+  // run the cores functionally until max_instrs have been executed,
+  // returns false once the program has completed
+  bool fast_forward(uint64_t max_instrs, uint64_t* instrs, int* exitcode) {
+    // instructions each warp executes before moving to the next one
+    static constexpr uint32_t QUANTUM = 1024;
+
+    // fast-forwarding runs on this host thread only
+    ram_->set_thread_safe(false);
+    for (auto& core : cores_) {
+      core->functional(true);
+    }
+    uint64_t executed;
+    bool running = true;
+    uint64_t total = 0;
+    do {
+      executed = 0;
+      for (auto& core : cores_) {
+        executed += core->step_functional(std::min<uint64_t>(QUANTUM, max_instrs - total));
+        if (core->check_exit()) {
+          *exitcode = core->getIRegValue(3);
+          running = false;
+          break;
+        }
+      }
+      total += executed;
+    } while (running && executed != 0 && total < max_instrs);
+    for (auto& core : cores_) {
+      core->functional(false);
+    }
+    ram_->set_thread_safe(SimPlatform::instance().num_threads() > 1);
+    *instrs += total;
+    return running && (executed != 0);
+  }
+
+  // run the timing model for the given number of cycles, idle cycles
+  // skipped by the platform included; returns false once the program 
+  // has completed
+  bool tick_detailed(uint64_t cycles, int* exitcode) {
+    uint64_t end = SimPlatform::instance().cycles() + cycles;
+    while (SimPlatform::instance().cycles() < end) {
+      SimPlatform::instance().tick();
+      bool running = false;
+      for (auto& core : cores_) {
+        if (core->running()) {
+          running = true;
+        }
+        if (core->check_exit()) {
+          *exitcode = core->getIRegValue(3);
+          return false;
+        }
+      }
+      if (!running)
+        return false;
+    }
+    return true;
+  }
+
+  bool stores_buffered() const {
+    for (auto& core : cores_) {
+      if (core->stores_buffered())
+        return true;
+    }
+    return false;
+  }
+
+  // stop issuing and tick until the buffered stores have been written to
+  // the dcache; the rest of the pipeline is left as the program ended it
+  void flush_stores() {
+    if (!this->stores_buffered())
+      return;
+    for (auto& core : cores_) {
+      core->drain(true);
+    }
+    while (this->stores_buffered()) {
+      SimPlatform::instance().tick();
+    }
+    for (auto& core : cores_) {
+      core->drain(false);
+    }
+  }
+
+  // stop issuing and tick until the timing model is empty
+  bool drain(int* exitcode) {
+    for (auto& core : cores_) {
+      core->drain(true);
+    }
+    bool running = true;
+    while (!SimPlatform::instance().idle()) {
+      SimPlatform::instance().tick();
+      for (auto& core : cores_) {
+        if (core->check_exit()) {
+          *exitcode = core->getIRegValue(3);
+          running = false;
+        }
+      }
+    }
+    for (auto& core : cores_) {
+      core->drain(false);
+    }
+    return running;
+  }
+
+  void dump_stats(std::ostream& os) const {
+    auto cycles = SimPlatform::instance().cycles();
+    auto total_instrs = this->counters().at(0);
+    for (auto& core : cores_) {
+      auto& perf = core->perf_stats();
+      auto& sched = core->scheduler().perf_stats();
+      auto& bpred = core->predictor().perf_stats();
+      auto icache = core->icache_stats();
+      auto dcache = core->dcache_stats();
+      if (sample_period_ != 0) {
+        // fast-forwarded instructions took no cycles, use the sampled estimate
+        os << std::dec << "PERF: core" << core->id() << ": instrs=" << perf.instrs
+           << ", detailed cycles=" << cycles;
+        if (sample_cpi_ != 0) {
+          os << ", estimated cycles=" << uint64_t(total_instrs * sample_cpi_)
+             << ", IPC=" << (double(perf.instrs) / std::max(total_instrs * sample_cpi_, 1.0));
+        }
+        os << std::endl;
+      } else {
+        os << std::dec << "PERF: core" << core->id() << ": instrs=" << perf.instrs
+           << ", cycles=" << cycles
+           << ", IPC=" << (double(perf.instrs) / std::max<uint64_t>(cycles, 1)) << std::endl;
+      }
+      os << "PERF: core" << core->id() << ": issue width=" << ISSUE_WIDTH
+         << ", issued=" << perf.issues
+         << ", issue rate=" << (double(perf.issues) / std::max<uint64_t>(cycles, 1))
+         << ", unit stalls=" << perf.unit_stalls
+         << ", writeback ports=" << WRITEBACK_PORTS
+         << ", writeback stalls=" << perf.wb_stalls << std::endl;
+      os << "PERF: core" << core->id() << ": warp policy=" << warp_policy_name(core->scheduler().policy())
+         << ", scheduler stalls=" << sched.stalls
+         << ", idles=" << sched.idles
+         << ", switches=" << sched.switches
+         << ", pool stalls=" << sched.pool_stalls << std::endl;
+      os << "PERF: core" << core->id() << ": branch predictor=" << branch_policy_name(core->predictor().policy())
+         << ", branches=" << bpred.branches
+         << ", taken=" << bpred.taken;
+      if (core->predictor().policy() != BranchPolicy::NONE) {
+        // without prediction, control instructions stall and are never mispredicted
+        os << ", mispredictions=" << bpred.mispredicts
+           << " (accuracy=" << (bpred.branches ? 100 - (100 * bpred.mispredicts / bpred.branches) : 100) << "%)"
+           << ", wrong-path fetches=" << perf.wrong_path_fetches
+           << ", mispredict penalty=" << BRANCH_MISPREDICT_PENALTY;
+      }
+      os << std::endl;
+      os << "PERF: core" << core->id() << ": icache reads=" << icache.reads
+         << ", read misses=" << icache.read_misses
+         << ", prefetches=" << icache.prefetches
+         << ", referenced=" << icache.prefetch_hits
+         << ", ibuffer stalls=" << perf.ibuf_stalls << std::endl;
+      os << "PERF: core" << core->id() << ": dcache reads=" << dcache.reads
+         << ", read misses=" << dcache.read_misses
+         << " (hit ratio=" << (dcache.reads ? 100 - (100 * dcache.read_misses / dcache.reads) : 100) << "%)" << std::endl;
+      os << "PERF: core" << core->id() << ": dcache bytes fetched=" << dcache.bytes_fetched
+         << ", bytes used=" << dcache.bytes_used
+         << " (utilization=" << (dcache.bytes_fetched ? (100 * dcache.bytes_used / dcache.bytes_fetched) : 0) << "%)" << std::endl;
+      os << "PERF: core" << core->id() << ": dcache victim fills=" << dcache.victim_fills
+         << ", victim hits=" << dcache.victim_hits
+         << " (read=" << dcache.victim_read_hits << ", write=" << (dcache.victim_hits - dcache.victim_read_hits) << ")" << std::endl;
+      os << "PERF: core" << core->id() << ": dcache prefetches=" << dcache.prefetches
+         << ", referenced=" << dcache.prefetch_hits
+         << " (accuracy=" << (dcache.prefetches ? (100 * dcache.prefetch_hits / dcache.prefetches) : 0) << "%"
+         << ", coverage=" << ((dcache.prefetch_hits + dcache.read_misses) ? (100 * dcache.prefetch_hits / (dcache.prefetch_hits + dcache.read_misses)) : 0) << "%)" << std::endl;
+      os << "PERF: core" << core->id() << ": lsu instrs=" << perf.dcache_instrs
+         << ", dcache requests=" << perf.dcache_reqs
+         << ", requests per instr=" << (double(perf.dcache_reqs) / std::max<uint64_t>(perf.dcache_instrs, 1)) << std::endl;
+      os << "PERF: core" << core->id() << ": store buffer lines=" << STORE_BUFFER_SIZE
+         << ", buffered stores=" << perf.stores_buffered
+         << ", merges=" << perf.store_merges
+         << ", line writes=" << perf.store_drains
+         << ", load forwards=" << perf.store_forwards << std::endl;
+      os << "PERF: core" << core->id() << ": dcache bank conflicts=";
+      dump_histogram(os, core->dcache_bank_conflicts());
+      os << std::endl;
+      os << "PERF: core" << core->id() << ": smem bank conflicts=";
+      dump_histogram(os, core->smem_bank_conflicts());
+      os << std::endl;
+    }
+    for (uint32_t i = 0; i < l2caches_.size(); ++i) {
+      if (l2caches_.at(i)) {
+        this->dump_cache_stats(os, "l2cache" + std::to_string(i), *l2caches_.at(i));
+      }
+    }
+    if (l3cache_) {
+      this->dump_cache_stats(os, "l3cache", *l3cache_);
+    }
+    auto& dram = memsim_->perf_stats();
+    os << "PERF: dram: reads=" << dram.reads
+       << ", writes=" << dram.writes
+       << ", bytes read=" << dram.bytes_read
+       << ", bytes written=" << dram.bytes_written << std::endl;
+  }
+
+  // prints per-bank counts with their share of the total
+  static void dump_histogram(std::ostream& os, const std::vector<uint64_t>& counts) {
+    uint64_t total = 0;
+    for (auto count : counts) {
+      total += count;
+    }
+    os << total << " [";
+    for (uint32_t i = 0; i < counts.size(); ++i) {
+      if (i != 0) os << ", ";
+      os << counts.at(i) << " (" << (total ? (100 * counts.at(i) / total) : 0) << "%)";
+    }
+    os << "]";
+  }
+
+  static void dump_cache_stats(std::ostream& os, const std::string& name, const Cache& cache) {
+    auto& stats = cache.perf_stats();
+    os << "PERF: " << name << ": reads=" << stats.reads
+       << ", read misses=" << stats.read_misses
+       << " (hit ratio=" << (stats.reads ? 100 - (100 * stats.read_misses / stats.reads) : 100) << "%)"
+       << ", writes=" << stats.writes
+       << ", evictions=" << stats.evictions 
+       << ", bytes fetched=" << stats.bytes_fetched
+       << ", bytes used=" << stats.bytes_used << std::endl;
+    os << "PERF: " << name << ": bank conflicts=";
+    dump_histogram(os, cache.bank_conflicts());
+    os << std::endl;
+  }
+
+  // instructions followed by the pipeline stall counters, summed over all cores
+  std::array<uint64_t, 1 + NUM_STALLS> counters() const {
+    std::array<uint64_t, 1 + NUM_STALLS> values{};
+    for (auto& core : cores_) {
+      auto& perf = core->perf_stats();
+      values.at(0) += perf.instrs;
+      values.at(1) += perf.ibuf_stalls;
+      values.at(2) += perf.scrb_stalls;
+      values.at(3) += perf.alu_stalls;
+      values.at(4) += perf.lsu_stalls;
+      values.at(5) += perf.csr_stalls;
+      values.at(6) += perf.fpu_stalls;
+      values.at(7) += perf.gpu_stalls;
+    }
+    return values;
+  }
+
+  void save(const std::string& filename) {
+    std::ofstream ofs(filename, std::ios::binary);
+    if (!ofs)
+      throw CheckpointError("cannot create " + filename);
+    CheckpointWriter writer(ofs);
+    writer.section("vortex");
+    writer.write(arch_.num_cores());
+    writer.write(arch_.num_warps());
+    writer.write(arch_.num_threads());
+    writer.write(SimPlatform::instance().cycles());
+    ram_->save(writer);
+    for (auto& core : cores_) {
+      core->save(writer);
+    }
+    for (auto& l2cache : l2caches_) {
+      if (l2cache) {
+        l2cache->save(writer);
+      }
+    }
+    if (l3cache_) {
+      l3cache_->save(writer);
+    }
+    std::cout << "checkpoint saved to " << filename 
+              << " at cycle " << SimPlatform::instance().cycles() << std::endl;
+  }
+
+  void restore(const std::string& filename) {
+    std::ifstream ifs(filename, std::ios::binary);
+    if (!ifs)
+      throw CheckpointError("cannot open " + filename);
+    CheckpointReader reader(ifs);
+    reader.section("vortex");
+    reader.expect(arch_.num_cores(), "number of cores");
+    reader.expect(arch_.num_warps(), "number of warps");
+    reader.expect(arch_.num_threads(), "number of threads");
+    auto cycle = reader.read<uint64_t>();
+    // the event queue is empty in a drained checkpoint, restart the clock
+    SimPlatform::instance().reset(cycle);
+    ram_->restore(reader);
+    for (auto& core : cores_) {
+      core->restore(reader);
+    }
+    for (auto& l2cache : l2caches_) {
+      if (l2cache) {
+        l2cache->restore(reader);
+      }
+    }
+    if (l3cache_) {
+      l3cache_->restore(reader);
+    }
+    std::cout << "checkpoint restored from " << filename 
+              << " at cycle " << cycle << std::endl;
+  }
+
   //Added
   void set_core_satp(uint32_t satp) {
     for (auto core : cores_) {
@@ -180,10 +720,46 @@ void Processor::attach_ram(RAM* mem) {
   impl_->attach_ram(mem);
 }
 
+void Processor::set_num_threads(uint32_t num_threads) {
+  impl_->set_num_threads(num_threads);
+}
+
 int Processor::run() {
   return impl_->run();
 }
 
+void Processor::set_functional(bool enable) {
+  impl_->set_functional(enable);
+}
+
+void Processor::set_profiling(bool enable) {
+  impl_->set_profiling(enable);
+}
+
+bool Processor::set_warp_policy(const char* name) {
+  return impl_->set_warp_policy(name);
+}
+
+bool Processor::set_branch_policy(const char* name) {
+  return impl_->set_branch_policy(name);
+}
+
+void Processor::set_show_stats(bool enable) {
+  impl_->set_show_stats(enable);
+}
+
+void Processor::set_sampling(uint64_t period, uint64_t warmup, uint64_t window) {
+  impl_->set_sampling(period, warmup, window);
+}
+
+void Processor::save_checkpoint(const char* filename, uint64_t cycle) {
+  impl_->save_checkpoint(filename, cycle);
+}
+
+void Processor::restore_checkpoint(const char* filename) {
+  impl_->restore_checkpoint(filename);
+}
+
   //Added
   uint32_t Processor::get_satp() {
     return this->satp;
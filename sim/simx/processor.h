@@ -13,8 +13,38 @@ public:
 
   void attach_ram(RAM* mem);
 
+  // number of host threads used to simulate the cores
+  void set_num_threads(uint32_t num_threads);
+
+  // execute instructions without the timing model
+  void set_functional(bool enable);
+
+  // alternate functional fast-forwarding of period instructions with
+  // detailed windows of warmup and measured cycles
+  void set_sampling(uint64_t period, uint64_t warmup, uint64_t window);
+
+  // report host time per component on exit
+  void set_profiling(bool enable);
+
+  // warp scheduling policy: rr, gto, two-level or locality
+  // returns false for an unknown policy
+  bool set_warp_policy(const char* name);
+
+  // branch prediction: none, not-taken or btb
+  // returns false for an unknown policy
+  bool set_branch_policy(const char* name);
+
+  // report per-core performance counters on exit
+  void set_show_stats(bool enable);
+
   int run();
 
+  // save a checkpoint once the given cycle is reached
+  void save_checkpoint(const char* filename, uint64_t cycle);
+
+  // resume the next run from a checkpoint
+  void restore_checkpoint(const char* filename);
+
   uint32_t get_satp();//added
   void set_satp(uint32_t satp);//added
 private:
@@ -0,0 +1,276 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <assert.h>
+#include <checkpoint.h>
+#include "types.h"
+#include "archdef.h"
+
+namespace vortex {
+
+enum class WarpPolicy {
+    RR,         // loose round-robin
+    GTO,        // greedy-then-oldest
+    TWO_LEVEL,  // round-robin within an active pool
+    LOCALITY,   // warps whose loads hit in the cache first
+};
+
+inline const char* warp_policy_name(WarpPolicy policy) {
+    switch (policy) {
+    case WarpPolicy::RR:        return "rr";
+    case WarpPolicy::GTO:       return "gto";
+    case WarpPolicy::TWO_LEVEL: return "two-level";
+    case WarpPolicy::LOCALITY:  return "locality";
+    }
+    return "";
+}
+
+inline bool parse_warp_policy(const std::string& name, WarpPolicy* policy) {
+    for (auto p : {WarpPolicy::RR, WarpPolicy::GTO, WarpPolicy::TWO_LEVEL, WarpPolicy::LOCALITY}) {
+        if (name == warp_policy_name(p)) {
+            *policy = p;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Picks the warps to fetch each cycle, up to ISSUE_WIDTH of them.
+// Warps are ready when active and not stalled. Warps with loads in flight
+// are long-latency candidates for the two-level policy, and completed load
+// latencies feed the locality score.
+class WarpScheduler {
+public:
+    struct PerfStats {
+        uint64_t idles;         // no active warp
+        uint64_t stalls;        // active warps, none ready for a fetch slot
+        uint64_t pool_stalls;   // two-level: ready warps only outside the pool
+        uint64_t switches;      // a different warp than the previous one
+
+        PerfStats()
+            : idles(0)
+            , stalls(0)
+            , pool_stalls(0)
+            , switches(0)
+        {}
+    };
+
+    static constexpr uint32_t MAX_LOCALITY = 15;
+
+    WarpScheduler(const ArchDef& arch)
+        : num_warps_(arch.num_warps())
+        , policy_(WarpPolicy::RR)
+        , pool_size_(std::max<uint32_t>(arch.num_warps() / 2, 1))
+        , ages_(arch.num_warps())
+        , pending_loads_(arch.num_warps())
+        , locality_(arch.num_warps())
+    {
+        this->clear();
+    }
+
+    void set_policy(WarpPolicy policy) {
+        policy_ = policy;
+    }
+
+    WarpPolicy policy() const {
+        return policy_;
+    }
+
+    void clear() {
+        last_wid_ = 0;
+        prev_active_.reset();
+        next_age_ = 0;
+        min_load_latency_ = UINT64_MAX;
+        pool_.reset();
+        for (uint32_t i = 0; i < num_warps_; ++i) {
+            ages_.at(i) = 0;
+            pending_loads_.at(i) = 0;
+            locality_.at(i) = 0;
+        }
+        perf_stats_ = PerfStats();
+    }
+
+    // returns the selected warp, or -1 when none is ready
+    int select(const WarpMask& active, const WarpMask& stalled) {
+        this->update_ages(active);
+
+        if (active.none()) {
+            ++perf_stats_.idles;
+            return -1;
+        }
+
+        auto ready = active & ~stalled;
+
+        int wid = -1;
+        switch (policy_) {
+        case WarpPolicy::RR:
+            wid = this->select_rr(ready);
+            break;
+        case WarpPolicy::GTO:
+            wid = this->select_gto(ready);
+            break;
+        case WarpPolicy::TWO_LEVEL:
+            wid = this->select_two_level(active, ready);
+            break;
+        case WarpPolicy::LOCALITY:
+            wid = this->select_locality(ready);
+            break;
+        }
+
+        if (wid < 0) {
+            ++perf_stats_.stalls;
+            return -1;
+        }
+
+        if ((uint32_t)wid != last_wid_) {
+            ++perf_stats_.switches;
+        }
+        last_wid_ = wid;
+        return wid;
+    }
+
+    // the active warps seen by the last select()
+    const WarpMask& active_warps() const {
+        return prev_active_;
+    }
+
+    // counts cycles in which select() was not called because the core was
+    // idle; it would have found no ready warp in each of them
+    void skip(uint64_t idles, uint64_t stalls) {
+        perf_stats_.idles += idles;
+        perf_stats_.stalls += stalls;
+    }
+
+    void load_issued(uint32_t wid) {
+        ++pending_loads_.at(wid);
+    }
+
+    // loads within twice the shortest latency seen count as cache hits
+    void load_completed(uint32_t wid, uint64_t latency) {
+        assert(pending_loads_.at(wid) != 0);
+        --pending_loads_.at(wid);
+        min_load_latency_ = std::min(min_load_latency_, latency);
+        auto& score = locality_.at(wid);
+        if (latency <= 2 * min_load_latency_) {
+            score = (score < MAX_LOCALITY) ? (score + 1) : score;
+        } else {
+            score = (score > 2) ? (score - 2) : 0;
+        }
+    }
+
+    const PerfStats& perf_stats() const {
+        return perf_stats_;
+    }
+
+    void save(CheckpointWriter& writer) const {
+        writer.write(last_wid_);
+        writer.write<uint32_t>(prev_active_.to_ulong());
+        writer.write(next_age_);
+        writer.write(min_load_latency_);
+        writer.write<uint32_t>(pool_.to_ulong());
+        writer.write(ages_);
+        writer.write(locality_);
+    }
+
+    void restore(CheckpointReader& reader) {
+        reader.read(&last_wid_);
+        prev_active_ = reader.read<uint32_t>();
+        reader.read(&next_age_);
+        reader.read(&min_load_latency_);
+        pool_ = reader.read<uint32_t>();
+        reader.read(&ages_);
+        reader.read(&locality_);
+        // checkpoints are taken with the pipeline drained
+        for (auto& count : pending_loads_) {
+            count = 0;
+        }
+    }
+
+private:
+
+    // warps are ordered by the time they last became active
+    void update_ages(const WarpMask& active) {
+        auto started = active & ~prev_active_;
+        if (started.any()) {
+            for (uint32_t i = 0; i < num_warps_; ++i) {
+                if (started.test(i)) {
+                    ages_.at(i) = next_age_++;
+                }
+            }
+        }
+        prev_active_ = active;
+    }
+
+    int select_rr(const WarpMask& ready) const {
+        for (uint32_t i = 1; i <= num_warps_; ++i) {
+            uint32_t wid = (last_wid_ + i) % num_warps_;
+            if (ready.test(wid))
+                return wid;
+        }
+        return -1;
+    }
+
+    int select_gto(const WarpMask& ready) const {
+        if (ready.test(last_wid_))
+            return last_wid_;
+        int oldest = -1;
+        for (uint32_t i = 0; i < num_warps_; ++i) {
+            if (ready.test(i) && (oldest < 0 || ages_.at(i) < ages_.at(oldest))) {
+                oldest = i;
+            }
+        }
+        return oldest;
+    }
+
+    int select_two_level(const WarpMask& active, const WarpMask& ready) {
+        // demote inactive warps and warps waiting on loads
+        for (uint32_t i = 0; i < num_warps_; ++i) {
+            if (pool_.test(i) && (!active.test(i) || pending_loads_.at(i) != 0)) {
+                pool_.reset(i);
+            }
+        }
+        // promote pending warps in round-robin order
+        for (uint32_t i = 1; i <= num_warps_ && pool_.count() < pool_size_; ++i) {
+            uint32_t wid = (last_wid_ + i) % num_warps_;
+            if (active.test(wid) && !pool_.test(wid) && 0 == pending_loads_.at(wid)) {
+                pool_.set(wid);
+            }
+        }
+        // every active warp may be waiting on loads
+        if (pool_.none())
+            return this->select_rr(ready);
+        auto wid = this->select_rr(ready & pool_);
+        if (wid < 0 && (ready & ~pool_).any()) {
+            ++perf_stats_.pool_stalls;
+        }
+        return wid;
+    }
+
+    int select_locality(const WarpMask& ready) const {
+        int best = -1;
+        for (uint32_t i = 1; i <= num_warps_; ++i) {
+            uint32_t wid = (last_wid_ + i) % num_warps_;
+            if (ready.test(wid) && (best < 0 || locality_.at(wid) > locality_.at(best))) {
+                best = wid;
+            }
+        }
+        return best;
+    }
+
+    uint32_t num_warps_;
+    WarpPolicy policy_;
+    uint32_t pool_size_;
+    uint32_t last_wid_;
+    WarpMask prev_active_;
+    uint64_t next_age_;
+    uint64_t min_load_latency_;
+    WarpMask pool_;
+    std::vector<uint64_t> ages_;
+    std::vector<uint32_t> pending_loads_;
+    std::vector<uint32_t> locality_;
+    PerfStats perf_stats_;
+};
+
+}
@@ -16,13 +16,19 @@ private:
     std::vector<RegMask> in_use_iregs_;
     std::vector<RegMask> in_use_fregs_;
     std::vector<RegMask> in_use_vregs_;
-    std::unordered_map<uint32_t, uint64_t> owners_; 
+    std::vector<uint64_t> owners_; 
+
+    // owner slot of a register, for each warp and register type
+    static uint32_t owner_index(uint32_t wid, RegType type, uint32_t reg) {
+        return (wid * 3 + ((int)type - 1)) * 32 + reg;
+    }
 
 public:    
     Scoreboard(const ArchDef &arch) 
         : in_use_iregs_(arch.num_warps())
         , in_use_fregs_(arch.num_warps())
         , in_use_vregs_(arch.num_warps())
+        , owners_(arch.num_warps() * 3 * 32)
     {
         this->clear();
     }
@@ -33,7 +39,6 @@ public:
             in_use_fregs_.at(i).reset();
             in_use_vregs_.at(i).reset();
         }
-        owners_.clear();
     }
 
     bool in_use(pipeline_trace_t* state) const {
@@ -49,8 +54,7 @@ public:
             auto used_iregs = state->used_iregs & in_use_iregs_.at(state->wid);        
             while (used_iregs.any()) {
                 if (used_iregs.test(0)) {
-                    uint32_t tag = (r << 16) | (state->wid << 4) | (int)RegType::Integer;
-                    out.push_back({RegType::Integer, r, owners_.at(tag)});
+                    out.push_back({RegType::Integer, r, owners_.at(owner_index(state->wid, RegType::Integer, r))});
                 }
                 used_iregs >>= 1;
                 ++r;
@@ -61,8 +65,7 @@ public:
             auto used_fregs = state->used_fregs & in_use_fregs_.at(state->wid);
             while (used_fregs.any()) {
                 if (used_fregs.test(0)) {
-                    uint32_t tag = (r << 16) | (state->wid << 4) | (int)RegType::Float;
-                    out.push_back({RegType::Float, r, owners_.at(tag)});
+                    out.push_back({RegType::Float, r, owners_.at(owner_index(state->wid, RegType::Float, r))});
                 }
                 used_fregs >>= 1;
                 ++r;
@@ -73,8 +76,7 @@ public:
             auto used_vregs = state->used_vregs & in_use_vregs_.at(state->wid);
             while (used_vregs.any()) {
                 if (used_vregs.test(0)) {
-                    uint32_t tag = (r << 16) | (state->wid << 4) | (int)RegType::Vector;
-                    out.push_back({RegType::Vector, r, owners_.at(tag)});
+                    out.push_back({RegType::Vector, r, owners_.at(owner_index(state->wid, RegType::Vector, r))});
                 }
                 used_vregs >>= 1;
                 ++r;
@@ -88,20 +90,21 @@ public:
             return;  
         switch (state->rdest_type) {
         case RegType::Integer:            
+            assert(!in_use_iregs_.at(state->wid).test(state->rdest));
             in_use_iregs_.at(state->wid).set(state->rdest);
             break;
         case RegType::Float:
+            assert(!in_use_fregs_.at(state->wid).test(state->rdest));
             in_use_fregs_.at(state->wid).set(state->rdest);
             break;
         case RegType::Vector:
+            assert(!in_use_vregs_.at(state->wid).test(state->rdest));
             in_use_vregs_.at(state->wid).set(state->rdest);
             break;
         default:  
-            break;
+            return;
         }      
-        uint32_t tag = (state->rdest << 16) | (state->wid << 4) | (int)state->rdest_type;
-        assert(owners_.count(tag) == 0);
-        owners_[tag] = state->uuid;
+        owners_.at(owner_index(state->wid, state->rdest_type, state->rdest)) = state->uuid;
     }
 
     void release(pipeline_trace_t* state) {
@@ -120,8 +123,6 @@ public:
         default:  
             break;
         }      
-        uint32_t tag = (state->rdest << 16) | (state->wid << 4) | (int)state->rdest_type;
-        owners_.erase(tag);
     }
 };
 
@@ -2,6 +2,7 @@
 
 #include <simobject.h>
 #include <bitmanip.h>
+#include <checkpoint.h>
 #include <vector>
 #include "types.h"
 
@@ -17,6 +18,7 @@ public:
         uint32_t bank_offset;
         uint32_t latency;
         bool     write_reponse;
+        IndexHash bank_hash;
     };
 
     struct PerfStats {
@@ -41,12 +43,25 @@ public:
         , config_(config)
         , bank_sel_addr_start_(config.bank_offset)
         , bank_sel_addr_end_(config.bank_offset + log2up(config.num_banks)-1)
+        , bank_hasher_(config.bank_hash, config.num_banks)
+        , bank_conflicts_(config.num_banks)
     {}    
     
     virtual ~SharedMem() {}
 
     void reset() {
         perf_stats_ = PerfStats();
+        for (auto& count : bank_conflicts_) {
+            count = 0;
+        }
+    }
+
+    bool idle() const {
+        for (auto& input : Inputs) {
+            if (!input.empty())
+                return false;
+        }
+        return true;
     }
 
     void tick() {
@@ -58,12 +73,20 @@ public:
 
             auto& core_req = core_req_port.front();
 
-            uint32_t bank_id = (uint32_t)bit_getw(
-                core_req.addr, bank_sel_addr_start_, bank_sel_addr_end_);
+            uint32_t bank_id;
+            if (bank_hasher_.hash() != IndexHash::None) {
+                bank_id = bank_hasher_(core_req.addr >> bank_sel_addr_start_);
+            } else {
+                bank_id = (uint32_t)bit_getw(
+                    core_req.addr, bank_sel_addr_start_, bank_sel_addr_end_);
+            }
 
             // bank conflict check
-            if (in_used_banks.at(bank_id))
+            if (in_used_banks.at(bank_id)) {
+                ++perf_stats_.bank_stalls;
+                ++bank_conflicts_.at(bank_id);
                 continue;
+            }
 
             in_used_banks.at(bank_id) = true;
 
@@ -86,10 +109,29 @@ public:
         return perf_stats_; 
     }
 
+    // bank stalls of each bank
+    const std::vector<uint64_t>& bank_conflicts() const { 
+        return bank_conflicts_; 
+    }
+
+    void save(CheckpointWriter& writer) const {
+        writer.section("smem");
+        writer.write(perf_stats_);
+        writer.write(bank_conflicts_);
+    }
+
+    void restore(CheckpointReader& reader) {
+        reader.section("smem");
+        reader.read(&perf_stats_);
+        reader.read(&bank_conflicts_);
+    }
+
 protected:
     Config    config_;
     uint32_t  bank_sel_addr_start_;
     uint32_t  bank_sel_addr_end_;
+    IndexHasher bank_hasher_;
+    std::vector<uint64_t> bank_conflicts_;
     PerfStats perf_stats_;
 };
 
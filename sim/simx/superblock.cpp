@@ -0,0 +1,201 @@
+#include "superblock.h"
+#include <assert.h>
+#include <util.h>
+#include "instr.h"
+#include "core.h"
+
+using namespace vortex;
+
+namespace vortex {
+
+// Block handlers mirror the matching cases of Warp::execute.
+struct BlockHandlers {
+#ifdef EXECUTE_LANES
+  static bool nop(Warp&, const BlockOp&, uint32_t) {
+    return true;
+  }
+
+  static bool fill(Warp& warp, const BlockOp& op, uint32_t tmask) {
+    auto& regs = warp.ireg_file_;
+    lanes::fill(regs.lanes(op.rd), op.imm, regs.stride(), tmask);
+    return true;
+  }
+
+  static bool alu(Warp& warp, const BlockOp& op, uint32_t tmask) {
+    auto& regs = warp.ireg_file_;
+    lanes::alu(op.alu, regs.lanes(op.rd), regs.lanes(op.rs1), regs.lanes(op.rs2), regs.stride(), tmask);
+    return true;
+  }
+
+  static bool alu_imm(Warp& warp, const BlockOp& op, uint32_t tmask) {
+    auto& regs = warp.ireg_file_;
+    lanes::alu_imm(op.alu, regs.lanes(op.rd), regs.lanes(op.rs1), op.imm, regs.stride(), tmask);
+    return true;
+  }
+
+  static bool load(Warp& warp, const BlockOp& op, uint32_t tmask) {
+    auto& regs = warp.ireg_file_;
+    uint32_t mem_bytes = 1 << (op.func3 & 0x3);
+    for (uint32_t t = 0, n = regs.num_threads(); t < n; ++t) {
+      if (0 == (tmask & (1u << t)))
+        continue;
+      uint64_t mem_addr = regs.at(t, op.rs1) + op.imm;
+      uint64_t mem_data = 0;
+      warp.core_->dcache_read(&mem_data, mem_addr, mem_bytes);
+      if (0 == op.rd)
+        continue;
+      switch (op.func3) {
+      case 0:
+        // RV32I: LB
+        regs.at(t, op.rd) = sext((Word)mem_data, 8);
+        break;
+      case 1:
+        // RV32I: LH
+        regs.at(t, op.rd) = sext((Word)mem_data, 16);
+        break;
+      default:
+        // RV32I: LW, LBU, LHU
+        regs.at(t, op.rd) = (Word)mem_data;
+        break;
+      }
+    }
+    return true;
+  }
+
+  static bool store(Warp& warp, const BlockOp& op, uint32_t tmask) {
+    auto& regs = warp.ireg_file_;
+    uint32_t mem_bytes = 1 << (op.func3 & 0x3);
+    uint64_t mask = ((uint64_t(1) << (8 * mem_bytes))-1);
+    for (uint32_t t = 0, n = regs.num_threads(); t < n; ++t) {
+      if (0 == (tmask & (1u << t)))
+        continue;
+      uint64_t mem_addr = regs.at(t, op.rs1) + op.imm;
+      uint64_t mem_data = regs.at(t, op.rs2) & mask;
+      warp.core_->dcache_write(&mem_data, mem_addr, mem_bytes);
+    }
+    // the rest of the block is stale once code has been written
+    return !warp.core_->code_written();
+  }
+
+  static bool branch(Warp& warp, const BlockOp& op, uint32_t tmask) {
+    auto& regs = warp.ireg_file_;
+    // the first active thread decides the branch
+    auto taken = lanes::cmp(op.cmp, regs.lanes(op.rs1), regs.lanes(op.rs2), regs.stride(), tmask);
+    if (taken & tmask & -tmask) {
+      warp.PC_ = op.imm;
+    }
+    return false;
+  }
+
+  static bool jal(Warp& warp, const BlockOp& op, uint32_t tmask) {
+    auto& regs = warp.ireg_file_;
+    if (op.rd) {
+      lanes::fill(regs.lanes(op.rd), op.next_pc, regs.stride(), tmask);
+    }
+    warp.PC_ = op.imm;
+    return false;
+  }
+#endif
+};
+
+}
+
+bool Superblock::translate(const Instr& instr, uint64_t pc, bool* terminal) {
+#ifdef EXECUTE_LANES
+  static const lanes::AluOp alu_ops[8] = {
+    lanes::AluOp::ADD, lanes::AluOp::SLL, lanes::AluOp::SLT, lanes::AluOp::SLTU,
+    lanes::AluOp::XOR, lanes::AluOp::SRL, lanes::AluOp::OR, lanes::AluOp::AND
+  };
+  static const lanes::CmpOp cmp_ops[8] = {
+    lanes::CmpOp::EQ, lanes::CmpOp::NE, lanes::CmpOp::EQ, lanes::CmpOp::EQ,
+    lanes::CmpOp::LT, lanes::CmpOp::GE, lanes::CmpOp::LTU, lanes::CmpOp::GEU
+  };
+
+  auto func3  = instr.getFunc3();
+  auto func7  = instr.getFunc7();
+  auto immsrc = sext((Word)instr.getImm(), 32);
+
+  BlockOp op;
+  op.handler = nullptr;
+  op.next_pc = pc + 4;
+  op.imm     = immsrc;
+  op.rd      = instr.getRDest();
+  op.rs1     = instr.getRSrc(0);
+  op.rs2     = instr.getRSrc(1);
+  op.func3   = func3;
+  op.alu     = alu_ops[func3];
+  op.cmp     = cmp_ops[func3];
+
+  *terminal = false;
+  bool rd_write = true;
+
+  switch (instr.getOpcode()) {
+  case LUI_INST:
+    op.handler = BlockHandlers::fill;
+    op.imm = immsrc << 12;
+    break;
+  case AUIPC_INST:
+    op.handler = BlockHandlers::fill;
+    op.imm = (immsrc << 12) + pc;
+    break;
+  case R_INST:
+    if (func7 & 0x1) {
+      // RV32M: only MUL maps to a lane operation
+      if (func3 != 0)
+        return false;
+      op.alu = lanes::AluOp::MUL;
+    } else if (func7 && func3 == 0) {
+      op.alu = lanes::AluOp::SUB;
+    } else if (func7 && func3 == 5) {
+      op.alu = lanes::AluOp::SRA;
+    }
+    op.handler = BlockHandlers::alu;
+    break;
+  case I_INST:
+    if (func7 && func3 == 5) {
+      op.alu = lanes::AluOp::SRA;
+    }
+    op.handler = BlockHandlers::alu_imm;
+    break;
+  case L_INST:
+    if (func3 == 3 || func3 > 5)
+      return false;
+    op.handler = BlockHandlers::load;
+    rd_write = false;
+    break;
+  case S_INST:
+    if (func3 > 2)
+      return false;
+    op.handler = BlockHandlers::store;
+    rd_write = false;
+    break;
+  case B_INST:
+    if (func3 == 2 || func3 == 3)
+      return false;
+    op.handler = BlockHandlers::branch;
+    rd_write = false;
+    op.imm = uint32_t(pc + immsrc);
+    *terminal = true;
+    break;
+  case JAL_INST:
+    op.handler = BlockHandlers::jal;
+    rd_write = false;
+    op.imm = uint32_t(pc + immsrc);
+    *terminal = true;
+    break;
+  default:
+    return false;
+  }
+
+  // ALU writes to x0 are dropped
+  if (rd_write && 0 == op.rd) {
+    op.handler = BlockHandlers::nop;
+  }
+
+  ops_.push_back(op);
+  return true;
+#else
+  __unused(instr, pc, terminal);
+  return false;
+#endif
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <memory>
+#include <unordered_map>
+#include "types.h"
+#include "lanes.h"
+
+namespace vortex {
+
+class Warp;
+class Instr;
+struct BlockOp;
+
+// Executes one translated instruction for the active threads of a warp.
+// Returns false when the block must stop after this instruction.
+typedef bool (*BlockHandler)(Warp& warp, const BlockOp& op, uint32_t tmask);
+
+struct BlockOp {
+  BlockHandler handler;
+  Word         next_pc;
+  Word         imm;     // immediate, constant result or branch target
+  uint32_t     rd;
+  uint32_t     rs1;
+  uint32_t     rs2;
+  uint32_t     func3;
+  lanes::AluOp alu;
+  lanes::CmpOp cmp;
+};
+
+// Straight-line code starting at a PC, ending at a branch, a jump or the
+// first instruction without a block handler.
+class Superblock {
+public:
+  static constexpr uint32_t MAX_OPS = 64;
+
+  Superblock(uint64_t pc) : pc_(pc) {}
+
+  uint64_t pc() const {
+    return pc_;
+  }
+
+  bool empty() const {
+    return ops_.empty();
+  }
+
+  uint32_t size() const {
+    return ops_.size();
+  }
+
+  std::vector<BlockOp>::const_iterator begin() const {
+    return ops_.begin();
+  }
+
+  std::vector<BlockOp>::const_iterator end() const {
+    return ops_.end();
+  }
+
+  // appends instr at pc, returns false if it has no block handler
+  bool translate(const Instr& instr, uint64_t pc, bool* terminal);
+
+private:
+  uint64_t pc_;
+  std::vector<BlockOp> ops_;
+};
+
+// Superblocks indexed by their start PC, with a direct-mapped table of
+// recent blocks in front of the map.
+class BlockCache {
+public:
+  BlockCache() {
+    this->clear();
+  }
+
+  const Superblock* lookup(uint64_t pc) {
+    auto& recent = recent_[(pc >> 2) & (RECENT_SIZE - 1)];
+    if (recent && recent->pc() == pc)
+      return recent;
+    auto it = blocks_.find(pc);
+    if (it == blocks_.end())
+      return nullptr;
+    recent = it->second.get();
+    return recent;
+  }
+
+  const Superblock* insert(std::unique_ptr<Superblock> block) {
+    auto ret = block.get();
+    recent_[(ret->pc() >> 2) & (RECENT_SIZE - 1)] = ret;
+    blocks_[ret->pc()] = std::move(block);
+    return ret;
+  }
+
+  // drop the blocks that overlap [addr, addr + size), including the 
+  // instruction that ended their translation
+  void invalidate(uint64_t addr, uint64_t size) {
+    bool erased = false;
+    for (auto it = blocks_.begin(); it != blocks_.end();) {
+      auto block_pc = it->second->pc();
+      auto block_end = block_pc + 4 * (it->second->size() + 1);
+      if (block_pc < addr + size && addr < block_end) {
+        it = blocks_.erase(it);
+        erased = true;
+      } else {
+        ++it;
+      }
+    }
+    if (erased) {
+      recent_.fill(nullptr);
+    }
+  }
+
+  void clear() {
+    blocks_.clear();
+    recent_.fill(nullptr);
+  }
+
+private:
+  static constexpr uint32_t RECENT_SIZE = 256;
+
+  std::unordered_map<uint64_t, std::unique_ptr<Superblock>> blocks_;
+  std::array<const Superblock*, RECENT_SIZE> recent_;
+};
+
+}
@@ -22,7 +22,7 @@ void TexUnit::clear() {
   }
 }
 
-uint32_t TexUnit::get_state(uint32_t state) {
+uint32_t TexUnit::get_state(uint32_t state) const {
   return states_.at(state);
 }
   
@@ -33,7 +33,7 @@ void TexUnit::set_state(uint32_t state, uint32_t value) {
 uint32_t TexUnit::read(int32_t u, 
                        int32_t v, 
                        int32_t lod, 
-                       std::vector<mem_addr_size_t>* mem_addrs) {
+                       ThreadMemAddrs* mem_addrs) {
   //--
   auto xu = Fixed<TEX_FXD_FRAC>::make(u);
   auto xv = Fixed<TEX_FXD_FRAC>::make(v);
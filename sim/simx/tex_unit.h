@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include "types.h"
 
 namespace vortex {
@@ -13,11 +14,11 @@ public:
 
     void clear();
 
-    uint32_t get_state(uint32_t state);
+    uint32_t get_state(uint32_t state) const;
   
     void set_state(uint32_t state, uint32_t value);
 
-    uint32_t read(int32_t u, int32_t v, int32_t lod, std::vector<mem_addr_size_t>* mem_addrs);
+    uint32_t read(int32_t u, int32_t v, int32_t lod, ThreadMemAddrs* mem_addrs);
 
 private:
 
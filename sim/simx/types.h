@@ -4,6 +4,7 @@
 #include <bitset>
 #include <queue>
 #include <unordered_map>
+#include <stdexcept>
 #include <util.h>
 #include <VX_config.h>
 #include <simobject.h>
@@ -217,6 +218,75 @@ inline std::ostream &operator<<(std::ostream &os, const ArbiterType& type) {
 
 ///////////////////////////////////////////////////////////////////////////////
 
+enum class IndexHash {
+  None,   // plain address bit slice
+  Xor,    // slice XOR-folded with the upper address bits
+  Prime   // modulo the largest prime not above the index range
+};
+
+inline std::ostream &operator<<(std::ostream &os, const IndexHash& hash) {
+  switch (hash) {
+  case IndexHash::None:  os << "None"; break;
+  case IndexHash::Xor:   os << "Xor"; break;
+  case IndexHash::Prime: os << "Prime"; break;
+  }
+  return os;
+}
+
+// Maps an address shifted down to the index field onto [0, size).
+// size is a power of two; prime modulo leaves the top indices unused.
+class IndexHasher {
+public:
+  IndexHasher(IndexHash hash = IndexHash::None, uint32_t size = 1)
+    : hash_(hash)
+    , bits_(log2ceil(size))
+    , modulo_(size) {
+    if (hash == IndexHash::Prime) {
+      while (modulo_ > 2 && !is_prime(modulo_)) {
+        --modulo_;
+      }
+    }
+  }
+
+  IndexHash hash() const {
+    return hash_;
+  }
+
+  uint32_t operator()(uint64_t value) const {
+    if (0 == bits_)
+      return 0;
+    switch (hash_) {
+    case IndexHash::None:
+      break;
+    case IndexHash::Xor: {
+      uint64_t folded = 0;
+      for (; value != 0; value >>= bits_) {
+        folded ^= value;
+      }
+      value = folded;
+    } break;
+    case IndexHash::Prime:
+      return value % modulo_;
+    }
+    return value & ((uint64_t(1) << bits_) - 1);
+  }
+
+private:
+  static bool is_prime(uint32_t value) {
+    for (uint32_t i = 2; i * i <= value; ++i) {
+      if (0 == (value % i))
+        return false;
+    }
+    return true;
+  }
+
+  IndexHash hash_;
+  uint32_t  bits_;
+  uint32_t  modulo_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
 struct MemReq {
     uint64_t addr;
     bool write;
@@ -224,6 +294,8 @@ struct MemReq {
     uint32_t tag;
     uint32_t core_id;    
     uint64_t uuid;
+    uint64_t pc;    // issuing instruction, 0 if unknown
+    uint64_t sector_mask; // MEM_SECTOR_SIZE sectors of the memory block, 0 if whole
 
     MemReq(uint64_t _addr = 0, 
            bool _write = false,
@@ -237,12 +309,30 @@ struct MemReq {
         , tag(_tag)
         , core_id(_core_id)
         , uuid(_uuid)
+        , pc(0)
+        , sector_mask(0)
     {}
 };
 
+// sectors of the memory block at addr covered by size bytes
+inline uint64_t sector_mask(uint64_t addr, uint32_t size) {
+  static_assert(MEM_BLOCK_SIZE / MEM_SECTOR_SIZE <= 64, "sector mask too small");
+  uint32_t offset = addr % MEM_BLOCK_SIZE;
+  uint32_t first = offset / MEM_SECTOR_SIZE;
+  uint32_t last = std::min<uint32_t>(offset + std::max<uint32_t>(size, 1) - 1, MEM_BLOCK_SIZE - 1) / MEM_SECTOR_SIZE;
+  uint64_t mask = 0;
+  for (uint32_t i = first; i <= last; ++i) {
+    mask |= uint64_t(1) << i;
+  }
+  return mask;
+}
+
 inline std::ostream &operator<<(std::ostream &os, const MemReq& req) {
   os << "mem-" << (req.write ? "wr" : "rd") << ": ";
   os << "addr=" << std::hex << req.addr << std::dec << ", tag=" << req.tag << ", core_id=" << req.core_id;
+  if (req.sector_mask != 0) {
+    os << ", sectors=" << std::hex << req.sector_mask << std::dec;
+  }
   os << " (#" << std::dec << req.uuid << ")";
   return os;
 }
@@ -417,6 +507,78 @@ public:
 
 ///////////////////////////////////////////////////////////////////////////////
 
+// Vector with inline storage for up to N elements.
+template <typename T, uint32_t N>
+class FixedVector {
+private:
+  T data_[N];
+  uint32_t size_;
+
+public:
+  FixedVector() : size_(0) {}
+
+  bool empty() const {
+    return (0 == size_);
+  }
+
+  uint32_t size() const {
+    return size_;
+  }
+
+  static constexpr uint32_t capacity() {
+    return N;
+  }
+
+  // bounds-checked like std::vector::at
+  const T& at(uint32_t index) const {
+    if (index >= size_)
+      throw std::out_of_range("FixedVector::at");
+    return data_[index];
+  }
+
+  T& at(uint32_t index) {
+    if (index >= size_)
+      throw std::out_of_range("FixedVector::at");
+    return data_[index];
+  }
+
+  const T* begin() const {
+    return data_;
+  }
+
+  T* begin() {
+    return data_;
+  }
+
+  const T* end() const {
+    return data_ + size_;
+  }
+
+  T* end() {
+    return data_ + size_;
+  }
+
+  void push_back(const T& value) {
+    assert(size_ < N);
+    data_[size_++] = value;
+  }
+
+  void resize(uint32_t size) {
+    assert(size <= N);
+    size_ = size;
+  }
+
+  void clear() {
+    size_ = 0;
+  }
+};
+
+// memory addresses accessed by one thread: one per load or store,
+// or the four texels of a bilinear TEX lookup
+typedef FixedVector<mem_addr_size_t, 4> ThreadMemAddrs;
+
+///////////////////////////////////////////////////////////////////////////////
+
 template <typename Req, typename Rsp, uint32_t MaxInputs = 32>
 class Switch : public SimObject<Switch<Req, Rsp>> {
 private:
@@ -431,14 +593,15 @@ public:
     const char* name, 
     ArbiterType type, 
     uint32_t num_inputs, 
-    uint32_t delay = 1
+    uint32_t delay = 1,
+    uint32_t queue_size = 0
   ) 
     : SimObject<Switch<Req, Rsp, MaxInputs>>(ctx, name)    
     , type_(type)
     , delay_(delay)
     , cursor_(0)
     , tag_shift_(log2ceil(num_inputs))
-    , ReqIn(num_inputs, this)
+    , ReqIn(num_inputs, SimPort<Req>(this, queue_size))
     , ReqOut(this)
     , RspIn(this)    
     , RspOut(num_inputs, this)
@@ -456,6 +619,16 @@ public:
     cursor_ = 0;
   }
 
+  bool idle() const {
+    if (ReqIn.size() == 1)
+      return true;
+    for (auto& req_in : ReqIn) {
+      if (!req_in.empty())
+        return false;
+    }
+    return RspIn.empty();
+  }
+
   void tick() {  
     if (ReqIn.size() == 1)
       return;
@@ -465,11 +638,13 @@ public:
       uint32_t j = (cursor_ + i) % n;
       auto& req_in = ReqIn.at(j);      
       if (!req_in.empty()) {
-        auto& req = req_in.front();
+        auto req = req_in.front();
         if (tag_shift_) {
           req.tag = (req.tag << tag_shift_) | j;
         }
-        ReqOut.send(req, delay_);                
+        // stall on output backpressure
+        if (!ReqOut.try_send(req, delay_))
+          break;
         req_in.pop();
         this->update_cursor(j);
         break;
@@ -4,17 +4,42 @@
 #include <math.h>
 #include <assert.h>
 #include <util.h>
+#include <checkpoint.h>
 
 #include "instr.h"
 #include "core.h"
+#include "superblock.h"
 
 using namespace vortex;
 
+// registers are stored thread-major to keep the checkpoint layout
+template <typename T>
+static void save_regs(CheckpointWriter& writer, const RegFile<T>& regs) {
+  writer.write<uint32_t>(regs.num_threads());
+  for (uint32_t t = 0; t < regs.num_threads(); ++t) {
+    writer.write<uint32_t>(regs.num_regs());
+    for (uint32_t r = 0; r < regs.num_regs(); ++r) {
+      writer.write(regs.at(t, r));
+    }
+  }
+}
+
+template <typename T>
+static void restore_regs(CheckpointReader& reader, RegFile<T>& regs) {
+  reader.expect<uint32_t>(regs.num_threads(), "register file threads");
+  for (uint32_t t = 0; t < regs.num_threads(); ++t) {
+    reader.expect<uint32_t>(regs.num_regs(), "register file size");
+    for (uint32_t r = 0; r < regs.num_regs(); ++r) {
+      reader.read(&regs.at(t, r));
+    }
+  }
+}
+
 Warp::Warp(Core *core, uint32_t id)
     : id_(id)
     , core_(core)
-    , ireg_file_(core->arch().num_threads(), std::vector<Word>(core->arch().num_regs()))
-    , freg_file_(core->arch().num_threads(), std::vector<FWord>(core->arch().num_regs()))
+    , ireg_file_(core->arch().num_threads(), core->arch().num_regs())
+    , freg_file_(core->arch().num_threads(), core->arch().num_regs())
     , vreg_file_(core->arch().num_threads(), std::vector<Byte>(core->arch().vsize()))
 {
   this->clear();
@@ -24,13 +49,9 @@ void Warp::clear() {
   active_ = false;
   PC_ = STARTUP_ADDR;
   tmask_.reset();  
+  ireg_file_.clear();
+  freg_file_.clear();
   for (uint32_t i = 0, n = core_->arch().num_threads(); i < n; ++i) {
-    for (auto& reg : ireg_file_.at(i)) {
-      reg = 0;
-    }
-    for (auto& reg : freg_file_.at(i)) {
-      reg = 0;
-    }
     for (auto& reg : vreg_file_.at(i)) {
       reg = 0;
     }
@@ -48,8 +69,7 @@ void Warp::eval(pipeline_trace_t *trace) {
   /* Fetch and decode. */    
 
   uint32_t instr_code = 0;
-  core_->icache_read(&instr_code, PC_, sizeof(uint32_t));
-  auto instr = core_->decoder().decode(instr_code);
+  auto instr = core_->get_instr(PC_, &instr_code);
   if (!instr) {
     std::cout << std::hex << "Error: invalid instruction 0x" << instr_code << ", at PC=" << PC_ << std::endl;
     std::abort();
@@ -73,13 +93,70 @@ void Warp::eval(pipeline_trace_t *trace) {
     DPN(4, "  %r" << std::setfill('0') << std::setw(2) << std::dec << i << ':');
     // Integer register file
     for (uint32_t j = 0; j < core_->arch().num_threads(); ++j) {
-      DPN(4, ' ' << std::setfill('0') << std::setw(XLEN/4) << std::hex << ireg_file_.at(j).at(i) << std::setfill(' ') << ' ');
+      DPN(4, ' ' << std::setfill('0') << std::setw(XLEN/4) << std::hex << ireg_file_.at(j, i) << std::setfill(' ') << ' ');
     }
     DPN(4, '|');
     // Floating point register file
     for (uint32_t j = 0; j < core_->arch().num_threads(); ++j) {
-      DPN(4, ' ' << std::setfill('0') << std::setw(16) << std::hex << freg_file_.at(j).at(i) << std::setfill(' ') << ' ');
+      DPN(4, ' ' << std::setfill('0') << std::setw(16) << std::hex << freg_file_.at(j, i) << std::setfill(' ') << ' ');
     }
     DPN(4, std::endl);
   }  
-}
\ No newline at end of file
+}
+
+uint32_t Warp::execute_block(const Superblock& block) {
+  assert(tmask_.any());
+  uint32_t tmask = tmask_.to_ulong();
+  uint32_t executed = 0;
+  for (auto& op : block) {
+    ++executed;
+    PC_ = op.next_pc;
+    if (!op.handler(*this, op, tmask))
+      break;
+  }
+  return executed;
+}
+
+void Warp::save(CheckpointWriter& writer) const {
+  writer.section("warp");
+  writer.write(active_);
+  writer.write(PC_);
+  writer.write<uint32_t>(tmask_.to_ulong());
+  save_regs(writer, ireg_file_);
+  save_regs(writer, freg_file_);
+  writer.write(vreg_file_);
+  // the dominator stack is stored bottom-up
+  std::vector<DomStackEntry> entries;
+  for (auto dom_stack = dom_stack_; !dom_stack.empty(); dom_stack.pop()) {
+    entries.push_back(dom_stack.top());
+  }
+  writer.write<uint32_t>(entries.size());
+  for (auto it = entries.rbegin(); it != entries.rend(); ++it) {
+    writer.write<uint32_t>(it->tmask.to_ulong());
+    writer.write(it->PC);
+    writer.write(it->fallThrough);
+    writer.write(it->unanimous);
+  }
+  writer.write(vtype_);
+  writer.write(vl_);
+}
+
+void Warp::restore(CheckpointReader& reader) {
+  reader.section("warp");
+  reader.read(&active_);
+  reader.read(&PC_);
+  tmask_ = reader.read<uint32_t>();
+  restore_regs(reader, ireg_file_);
+  restore_regs(reader, freg_file_);
+  reader.read(&vreg_file_);
+  dom_stack_ = std::stack<DomStackEntry>();
+  for (uint32_t i = 0, n = reader.read<uint32_t>(); i < n; ++i) {
+    DomStackEntry entry(reader.read<uint32_t>());
+    reader.read(&entry.PC);
+    reader.read(&entry.fallThrough);
+    reader.read(&entry.unanimous);
+    dom_stack_.push(entry);
+  }
+  reader.read(&vtype_);
+  reader.read(&vl_);
+}
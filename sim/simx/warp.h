@@ -3,12 +3,19 @@
 
 #include <vector>
 #include <stack>
+#include <algorithm>
+#include <assert.h>
 #include "types.h"
+#include "lanes.h"
+
+class CheckpointWriter;
+class CheckpointReader;
 
 namespace vortex {
 
 class Core;
 class Instr;
+class Superblock;
 class pipeline_trace_t;
 struct DomStackEntry {
   DomStackEntry(const ThreadMask &tmask, Word PC) 
@@ -31,6 +38,70 @@ struct DomStackEntry {
   bool unanimous;
 };
 
+// Register file stored register-major: the lanes of one register are
+// contiguous, padded to a whole lane group and aligned for vector access.
+template <typename T>
+class RegFile {
+public:
+  RegFile(uint32_t num_threads, uint32_t num_regs)
+    : num_threads_(num_threads)
+    , num_regs_(num_regs)
+    , stride_((num_threads + lanes::LANE_GROUP - 1) & ~(lanes::LANE_GROUP - 1))
+    , storage_(stride_ * num_regs + lanes::LANE_ALIGN / sizeof(T))
+  {
+    auto addr = reinterpret_cast<uintptr_t>(storage_.data());
+    auto offset = ((lanes::LANE_ALIGN - (addr % lanes::LANE_ALIGN)) % lanes::LANE_ALIGN) / sizeof(T);
+    data_ = storage_.data() + offset;
+  }
+
+  RegFile(const RegFile&) = delete;
+  RegFile& operator=(const RegFile&) = delete;
+
+  uint32_t num_threads() const {
+    return num_threads_;
+  }
+
+  uint32_t num_regs() const {
+    return num_regs_;
+  }
+
+  // number of padded lanes per register
+  uint32_t stride() const {
+    return stride_;
+  }
+
+  T& at(uint32_t tid, uint32_t reg) {
+    assert(tid < num_threads_ && reg < num_regs_);
+    return data_[reg * stride_ + tid];
+  }
+
+  const T& at(uint32_t tid, uint32_t reg) const {
+    assert(tid < num_threads_ && reg < num_regs_);
+    return data_[reg * stride_ + tid];
+  }
+
+  T* lanes(uint32_t reg) {
+    assert(reg < num_regs_);
+    return data_ + reg * stride_;
+  }
+
+  const T* lanes(uint32_t reg) const {
+    assert(reg < num_regs_);
+    return data_ + reg * stride_;
+  }
+
+  void clear() {
+    std::fill(storage_.begin(), storage_.end(), T(0));
+  }
+
+private:
+  uint32_t num_threads_;
+  uint32_t num_regs_;
+  uint32_t stride_;
+  std::vector<T> storage_;
+  T* data_;
+};
+
 struct vtype {
   uint32_t vill;
   uint32_t vediv;
@@ -86,14 +157,25 @@ public:
   }
 
   uint32_t getIRegValue(uint32_t reg) const {
-    return ireg_file_.at(0).at(reg);
+    return ireg_file_.at(0, reg);
   }
 
   void eval(pipeline_trace_t *);
 
+  // runs a translated block, returns the number of instructions executed
+  uint32_t execute_block(const Superblock& block);
+
+  void save(CheckpointWriter& writer) const;
+
+  void restore(CheckpointReader& reader);
+
 private:
 
+  friend struct BlockHandlers;
+
   void execute(const Instr &instr, pipeline_trace_t *trace);
+
+  bool execute_lanes(const Instr &instr, pipeline_trace_t *trace);
   
   uint32_t id_;
   Core *core_;
@@ -102,8 +184,8 @@ private:
   Word PC_;
   ThreadMask tmask_;  
   
-  std::vector<std::vector<Word>> ireg_file_;
-  std::vector<std::vector<FWord>> freg_file_;
+  RegFile<Word> ireg_file_;
+  RegFile<FWord> freg_file_;
   std::vector<std::vector<Byte>> vreg_file_;
   std::stack<DomStackEntry> dom_stack_;
 
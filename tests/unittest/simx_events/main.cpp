@@ -0,0 +1,149 @@
+#include <simobject.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <new>
+#include <chrono>
+#include <atomic>
+
+// Measures host heap allocations per simulated cycle for SimPlatform's
+// event path: every cycle each producer sends a packet through a port and
+// each consumer schedules a callback event when it receives one.
+
+static std::atomic<uint64_t> num_allocs(0);
+
+void* operator new(size_t size) {
+    ++num_allocs;
+    void* ptr = malloc(size ? size : 1);
+    if (nullptr == ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    free(ptr);
+}
+
+struct Packet {
+    uint64_t data;
+    uint32_t tag;
+};
+
+class Consumer : public SimObject<Consumer> {
+public:
+    SimPort<Packet> Input;
+
+    Consumer(const SimContext& ctx, const char* name)
+        : SimObject<Consumer>(ctx, name)
+        , Input(this)
+        , received_(0)
+    {}
+
+    void reset() {
+        received_ = 0;
+    }
+
+    void tick() {
+        while (!Input.empty()) {
+            auto& pkt = Input.front();
+            SimPlatform::instance().schedule<Packet>([this](const Packet& pkt) {
+                received_ += pkt.tag;
+            }, pkt, 3);
+            Input.pop();
+        }
+    }
+
+    uint64_t received() const {
+        return received_;
+    }
+
+private:
+    uint64_t received_;
+};
+
+class Producer : public SimObject<Producer> {
+public:
+    SimPort<Packet> Output;
+
+    Producer(const SimContext& ctx, const char* name)
+        : SimObject<Producer>(ctx, name)
+        , Output(this)
+        , count_(0)
+    {}
+
+    void reset() {
+        count_ = 0;
+    }
+
+    void tick() {
+        Output.send(Packet{count_, 1}, 2 + (count_ % 4));
+        ++count_;
+    }
+
+private:
+    uint64_t count_;
+};
+
+static uint64_t run(uint64_t cycles) {
+    uint64_t allocs = num_allocs;
+    for (uint64_t i = 0; i < cycles; ++i) {
+        SimPlatform::instance().tick();
+    }
+    return num_allocs - allocs;
+}
+
+int main(int argc, char** argv) {
+    uint32_t num_pairs = (argc > 1) ? atoi(argv[1]) : 16;
+    uint32_t num_threads = (argc > 2) ? atoi(argv[2]) : 1;
+    uint64_t warmup_cycles = 1000;
+    uint64_t num_cycles = 1000000;
+
+    SimPlatform::instance().initialize();
+
+    std::vector<Consumer::Ptr> consumers;
+    for (uint32_t i = 0; i < num_pairs; ++i) {
+        SimPlatform::instance().begin_shard(i);
+        auto producer = Producer::Create("producer");
+        auto consumer = Consumer::Create("consumer");
+        producer->Output.bind(&consumer->Input);
+        consumers.push_back(consumer);
+        SimPlatform::instance().end_shard();
+    }
+
+    SimPlatform::instance().set_num_threads(num_threads);
+    SimPlatform::instance().reset();
+
+    auto warmup_allocs = run(warmup_cycles);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    auto steady_allocs = run(num_cycles);
+    auto end = std::chrono::high_resolution_clock::now();
+    double elapsed = std::chrono::duration<double>(end - start).count();
+
+    uint64_t received = 0;
+    for (auto& consumer : consumers) {
+        received += consumer->received();
+    }
+
+    printf("pairs=%u, threads=%u, events=%lu\n",
+           num_pairs, num_threads, (unsigned long)received * 2);
+    printf("warmup: %lu cycles, %.3f allocations/cycle\n",
+           (unsigned long)warmup_cycles, double(warmup_allocs) / warmup_cycles);
+    printf("steady: %lu cycles, %.3f allocations/cycle, %.0f cycles/s\n",
+           (unsigned long)num_cycles, double(steady_allocs) / num_cycles, num_cycles / elapsed);
+
+    consumers.clear();
+    SimPlatform::instance().finalize();
+
+    if (received == 0) {
+        printf("FAILED!\n");
+        return -1;
+    }
+
+    printf("PASSED!\n");
+
+    return 0;
+}
@@ -0,0 +1,296 @@
+#include <processor.h>
+#include <archdef.h>
+#include <mem.h>
+#include <constants.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <vector>
+
+// Runs small hand-assembled kernels through the simx timing model and
+// checks their results in memory.
+
+using namespace vortex;
+
+static constexpr uint64_t RESULT_ADDR = 0x90000000;
+
+///////////////////////////////////////////////////////////////////////////////
+
+// RV32 encodings used by the kernels below
+
+static uint32_t enc_r(uint32_t opcode, uint32_t f3, uint32_t f7, uint32_t rd, uint32_t rs1, uint32_t rs2) {
+    return (f7 << 25) | (rs2 << 20) | (rs1 << 15) | (f3 << 12) | (rd << 7) | opcode;
+}
+
+static uint32_t enc_i(uint32_t opcode, uint32_t f3, uint32_t rd, uint32_t rs1, int32_t imm) {
+    return ((imm & 0xfff) << 20) | (rs1 << 15) | (f3 << 12) | (rd << 7) | opcode;
+}
+
+static uint32_t enc_s(uint32_t f3, uint32_t rs1, uint32_t rs2, int32_t imm) {
+    return (((imm >> 5) & 0x7f) << 25) | (rs2 << 20) | (rs1 << 15) | (f3 << 12) | ((imm & 0x1f) << 7) | 0x23;
+}
+
+static uint32_t enc_b(uint32_t f3, uint32_t rs1, uint32_t rs2, int32_t imm) {
+    return (((imm >> 12) & 0x1) << 31) | (((imm >> 5) & 0x3f) << 25) | (rs2 << 20) | (rs1 << 15)
+         | (f3 << 12) | (((imm >> 1) & 0xf) << 8) | (((imm >> 11) & 0x1) << 7) | 0x63;
+}
+
+static uint32_t lui(uint32_t rd, uint32_t imm)              { return (imm & 0xfffff000) | (rd << 7) | 0x37; }
+static uint32_t auipc(uint32_t rd, uint32_t imm)            { return (imm & 0xfffff000) | (rd << 7) | 0x17; }
+static uint32_t addi(uint32_t rd, uint32_t rs1, int32_t imm) { return enc_i(0x13, 0, rd, rs1, imm); }
+static uint32_t andi(uint32_t rd, uint32_t rs1, int32_t imm) { return enc_i(0x13, 7, rd, rs1, imm); }
+static uint32_t slli(uint32_t rd, uint32_t rs1, int32_t sh)  { return enc_i(0x13, 1, rd, rs1, sh); }
+static uint32_t add(uint32_t rd, uint32_t rs1, uint32_t rs2) { return enc_r(0x33, 0, 0, rd, rs1, rs2); }
+static uint32_t lw(uint32_t rd, uint32_t rs1, int32_t imm)   { return enc_i(0x03, 2, rd, rs1, imm); }
+static uint32_t sw(uint32_t rs2, uint32_t rs1, int32_t imm)  { return enc_s(2, rs1, rs2, imm); }
+static uint32_t beq(uint32_t rs1, uint32_t rs2, int32_t imm) { return enc_b(0, rs1, rs2, imm); }
+static uint32_t bne(uint32_t rs1, uint32_t rs2, int32_t imm) { return enc_b(1, rs1, rs2, imm); }
+static uint32_t csrr(uint32_t rd, uint32_t csr)              { return enc_i(0x73, 2, rd, 0, csr); }
+static uint32_t tmc(uint32_t rs1)                            { return enc_r(0x6b, 0, 0, 0, rs1, 0); }
+static uint32_t wspawn(uint32_t rs1, uint32_t rs2)           { return enc_r(0x6b, 1, 0, 0, rs1, rs2); }
+
+///////////////////////////////////////////////////////////////////////////////
+
+static void on_timeout(int) {
+    printf("FAILED! simulation did not terminate\n");
+    _exit(-1);
+}
+
+// runs the kernel and returns num_words words of memory at RESULT_ADDR.
+// Each run uses a child process, the DRAM model keeps global state.
+static std::vector<uint32_t> run(const std::vector<uint32_t>& code,
+                                 uint32_t num_cores,
+                                 uint32_t num_threads,
+                                 uint32_t num_jobs,
+                                 uint32_t num_words,
+                                 const char* branch_policy = "none",
+                                 uint32_t num_warps = 1) {
+    std::vector<uint32_t> words(num_words, 0);
+    int fds[2];
+    if (pipe(fds) != 0) {
+        perror("pipe");
+        exit(-1);
+    }
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        {
+            ArchDef arch(num_cores, num_warps, num_threads);
+            RAM ram(RAM_PAGE_SIZE);
+            ram.write(code.data(), STARTUP_ADDR, code.size() * sizeof(uint32_t));
+            ram.write(words.data(), RESULT_ADDR, num_words * sizeof(uint32_t));
+            Processor processor(arch);
+            processor.attach_ram(&ram);
+            processor.set_num_threads(num_jobs);
+            if (!processor.set_branch_policy(branch_policy))
+                _exit(-1);
+            signal(SIGALRM, on_timeout);
+            alarm(60);
+            processor.run();
+            alarm(0);
+            ram.read(words.data(), RESULT_ADDR, num_words * sizeof(uint32_t));
+        }
+        ssize_t size = num_words * sizeof(uint32_t);
+        _exit((write(fds[1], words.data(), size) == size) ? 0 : -1);
+    }
+    close(fds[1]);
+    ssize_t size = num_words * sizeof(uint32_t);
+    bool done = (read(fds[0], words.data(), size) == size);
+    close(fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!done || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        printf("FAILED! simulation did not complete\n");
+        exit(-1);
+    }
+    return words;
+}
+
+// Core 2 keeps storing a countdown to a shared word while the other cores
+// keep loading it and sum what they observe. The sums depend on which
+// stores each load sees within a cycle, so they must be identical for any
+// number of host threads.
+static bool test_determinism() {
+    uint32_t num_cores = 4;
+    uint32_t iterations = 500;
+    std::vector<uint32_t> code = {
+        lui(10, RESULT_ADDR),       //      x10 = &result
+        lui(14, RESULT_ADDR + 0x10000), //  x14 = scratch buffer
+        addi(11, 0, iterations),    //      x11 = iterations
+        csrr(6, CSR_GCID),          //      x6 = core id
+        addi(7, 0, 2),
+        bne(6, 7, 32),              //      core 2 writes, the others read
+        sw(11, 10, 8),              // write: result[2] = x11
+        lw(13, 14, 0),              //      x13 = a new cache line
+        add(13, 13, 0),             //      wait for the load
+        addi(14, 14, 64),           //      x14 += line size
+        addi(11, 11, -1),           //      x11 -= 1
+        bne(11, 0, -20),            //      loop while x11 != 0
+        tmc(0),                     //      exit
+        addi(12, 0, 0),             // read: x12 = 0
+        lw(5, 10, 8),               // loop: x5 = result[2]
+        add(12, 12, 5),             //      x12 += x5
+        add(12, 12, 6),             //      x12 += core id
+        addi(11, 11, -1),           //      x11 -= 1
+        bne(11, 0, -16),            //      loop while x11 != 0
+        slli(6, 6, 2),
+        add(6, 6, 10),
+        sw(12, 6, 0),               //      result[core id] = x12
+        tmc(0),                     //      exit
+    };
+    auto serial = run(code, num_cores, 1, 1, num_cores);
+    for (uint32_t jobs = 1; jobs <= num_cores; jobs *= 2) {
+        for (uint32_t i = 0; i < 4; ++i) {
+            auto result = run(code, num_cores, 1, jobs, num_cores);
+            if (result != serial) {
+                printf("determinism: jobs=%u, run=%u, sums=%u,%u,%u, expected %u,%u,%u\n",
+                       jobs, i, result.at(0), result.at(1), result.at(3),
+                       serial.at(0), serial.at(1), serial.at(3));
+                return false;
+            }
+        }
+    }
+    printf("determinism: cores=%u, sums=%u,%u,%u\n", 
+           num_cores, serial.at(0), serial.at(1), serial.at(3));
+    return true;
+}
+
+// The loop alternates between taken and not-taken branches, so every
+// predictor fetches down wrong paths that have to be squashed without
+// affecting the result.
+static bool test_branch_speculation() {
+    std::vector<uint32_t> code = {
+        lui(10, RESULT_ADDR),       //      x10 = &result
+        addi(11, 0, 20),            //      x11 = 20
+        addi(12, 0, 0),             //      x12 = 0
+        andi(5, 11, 1),             // loop: x5 = x11 & 1
+        beq(5, 0, 8),               //      skip even numbers
+        add(12, 12, 11),            //      x12 += x11
+        addi(11, 11, -1),           //      x11 -= 1
+        bne(11, 0, -16),            //      loop while x11 != 0
+        sw(12, 10, 0),              //      result[0] = x12
+        tmc(0),                     //      exit
+    };
+    for (auto policy : {"none", "not-taken", "btb"}) {
+        auto result = run(code, 1, 1, 1, 1, policy);
+        if (result.at(0) != 100) {
+            printf("branch speculation: predictor=%s, sum=%u\n", policy, result.at(0));
+            return false;
+        }
+    }
+    printf("branch speculation: sum=100\n");
+    return true;
+}
+
+// The loop patches one of its own instructions after running it once,
+// so the second iteration has to decode the new one.
+static bool test_self_modifying_code() {
+    std::vector<uint32_t> code = {
+        lui(10, RESULT_ADDR),       //      x10 = &result
+        auipc(15, 0),               //      x15 = pc
+        lui(16, 0x00700000),
+        addi(16, 16, 0x613),        //      x16 = addi x12, x0, 7
+        addi(11, 0, 2),             //      x11 = iterations
+        addi(12, 0, 1),             // loop: x12 = 1, patched to 7
+        sw(12, 10, 0),              //      *x10 = x12
+        addi(10, 10, 4),            //      x10 += 4
+        sw(16, 15, 16),             //      patch the loop head
+        addi(11, 11, -1),           //      x11 -= 1
+        bne(11, 0, -20),            //      loop while x11 != 0
+        tmc(0),                     //      exit
+    };
+    auto result = run(code, 1, 1, 1, 2);
+    printf("self-modifying code: results=%u,%u\n", result.at(0), result.at(1));
+    return (1 == result.at(0)) && (7 == result.at(1));
+}
+
+// All threads store to a line of their own, more lines than the store
+// buffer holds, right after a store that is still buffered.
+static bool test_wide_store() {
+    uint32_t num_threads = 8;
+    uint32_t line_words = 16;
+    std::vector<uint32_t> code = {
+        lui(10, RESULT_ADDR),       //      x10 = &result
+        sw(0, 10, 4),               //      result[1] = 0
+        addi(5, 0, -1),
+        tmc(5),                     //      activate all threads
+        lui(10, RESULT_ADDR),       //      x10 = &result, in every thread
+        csrr(6, CSR_LTID),          //      x6 = thread id
+        addi(7, 6, 1),              //      x7 = thread id + 1
+        slli(6, 6, 6),
+        add(6, 6, 10),
+        sw(7, 6, 0),                //      result[thread id * 16] = x7
+        tmc(0),                     //      exit
+    };
+    static_assert(STORE_BUFFER_SIZE < 8, "the store has to overflow the buffer");
+    auto result = run(code, 1, num_threads, 1, num_threads * line_words);
+    for (uint32_t t = 0; t < num_threads; ++t) {
+        if (result.at(t * line_words) != t + 1) {
+            printf("wide store: thread %u stored %u\n", t, result.at(t * line_words));
+            return false;
+        }
+    }
+    printf("wide store: threads=%u, store buffer lines=%u\n", num_threads, STORE_BUFFER_SIZE);
+    return true;
+}
+
+// Warp 0 spawns the other warps, which exit right away, and continues
+// into the next icache line, which misses. With ISSUE_WIDTH > 1 that 
+// fetch goes out on another port than the hits of the spawned warps, and
+// its response arrives after they are done.
+static bool test_multi_warp() {
+    uint32_t num_warps = 4;
+    uint32_t line_words = 16;
+    std::vector<uint32_t> code = {
+        auipc(6, 0),                //      x6 = pc
+        addi(6, 6, 12),             //      x6 = &entry
+        beq(0, 0, 44),              //      goto spawn
+        tmc(0),                     // entry: exit
+    };
+    code.resize(line_words - 3, addi(0, 0, 0));
+    std::vector<uint32_t> spawn = {
+        lui(10, RESULT_ADDR),       // spawn: x10 = &result
+        addi(5, 0, num_warps),      //      x5 = num warps
+        wspawn(5, 6),               //      spawn warps at entry
+        addi(12, 0, 7),             //      x12 = 7, on the next line
+        sw(12, 10, 0),              //      result[0] = x12
+        tmc(0),                     //      exit
+    };
+    code.insert(code.end(), spawn.begin(), spawn.end());
+    auto result = run(code, 1, 1, 1, 1, "none", num_warps);
+    printf("multi-warp: warps=%u, issue width=%u, result=%u\n", num_warps, ISSUE_WIDTH, result.at(0));
+    return (7 == result.at(0));
+}
+
+int main() {
+    if (!test_wide_store()) {
+        printf("FAILED!\n");
+        return -1;
+    }
+
+    if (!test_multi_warp()) {
+        printf("FAILED!\n");
+        return -1;
+    }
+
+    if (!test_branch_speculation()) {
+        printf("FAILED!\n");
+        return -1;
+    }
+
+    if (!test_self_modifying_code()) {
+        printf("FAILED!\n");
+        return -1;
+    }
+
+    if (!test_determinism()) {
+        printf("FAILED!\n");
+        return -1;
+    }
+
+    printf("PASSED!\n");
+
+    return 0;
+}
@@ -0,0 +1,140 @@
+#include <lanes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <random>
+
+// Checks every lane implementation the host can run against the
+// single-lane reference on random operands mixed with edge values,
+// under full, partial and empty thread masks.
+
+using namespace vortex;
+using namespace vortex::lanes;
+
+static constexpr uint32_t MAX_LANES = 32;
+static constexpr uint32_t NUM_ROUNDS = 2000;
+
+static const AluOp alu_ops[] = {
+    AluOp::ADD, AluOp::SUB, AluOp::SLL, AluOp::SLT, AluOp::SLTU, AluOp::XOR,
+    AluOp::SRL, AluOp::SRA, AluOp::OR, AluOp::AND, AluOp::MUL
+};
+
+static const CmpOp cmp_ops[] = {
+    CmpOp::EQ, CmpOp::NE, CmpOp::LT, CmpOp::GE, CmpOp::LTU, CmpOp::GEU
+};
+
+static const uint32_t edge_values[] = {
+    0, 1, 2, 31, 32, 33, 63, 0xffff, 0x10000, 0x7fffffff, 0x80000000, 0x80000001, 0xfffffffe, 0xffffffff
+};
+
+static std::mt19937 rng(1);
+
+static uint32_t random_value() {
+    if (rng() & 1)
+        return edge_values[rng() % (sizeof(edge_values) / sizeof(edge_values[0]))];
+    return rng();
+}
+
+static uint32_t random_tmask(uint32_t num_lanes) {
+    uint32_t all = (num_lanes == 32) ? 0xffffffff : ((1u << num_lanes) - 1);
+    switch (rng() % 4) {
+    case 0: return all;
+    case 1: return 0;
+    case 2: return (1u << (rng() % num_lanes)) & all;
+    default: return rng() & all;
+    }
+}
+
+static bool check_lanes(const char* isa, const char* func, int op, const uint32_t* dst, const uint32_t* ref, uint32_t num_lanes, uint32_t tmask) {
+    for (uint32_t t = 0; t < num_lanes; ++t) {
+        if (dst[t] != ref[t]) {
+            printf("%s: %s op=%d lanes=%u tmask=0x%x lane=%u: 0x%x, expected 0x%x\n",
+                   isa, func, op, num_lanes, tmask, t, dst[t], ref[t]);
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool test_isa(const char* isa) {
+    alignas(LANE_ALIGN) uint32_t a[MAX_LANES];
+    alignas(LANE_ALIGN) uint32_t b[MAX_LANES];
+    alignas(LANE_ALIGN) uint32_t dst[MAX_LANES];
+    uint32_t ref[MAX_LANES];
+
+    for (uint32_t round = 0; round < NUM_ROUNDS; ++round) {
+        uint32_t num_lanes = LANE_GROUP * (1 + rng() % (MAX_LANES / LANE_GROUP));
+        for (uint32_t t = 0; t < num_lanes; ++t) {
+            a[t] = random_value();
+            b[t] = random_value();
+        }
+        uint32_t imm = random_value();
+
+        for (auto op : alu_ops) {
+            uint32_t tmask = random_tmask(num_lanes);
+            for (uint32_t t = 0; t < num_lanes; ++t) {
+                dst[t] = ref[t] = rng();
+                if (tmask & (1u << t)) {
+                    ref[t] = eval_alu(op, a[t], b[t]);
+                }
+            }
+            alu(op, dst, a, b, num_lanes, tmask);
+            if (!check_lanes(isa, "alu", int(op), dst, ref, num_lanes, tmask))
+                return false;
+
+            for (uint32_t t = 0; t < num_lanes; ++t) {
+                dst[t] = ref[t] = rng();
+                if (tmask & (1u << t)) {
+                    ref[t] = eval_alu(op, a[t], imm);
+                }
+            }
+            alu_imm(op, dst, a, imm, num_lanes, tmask);
+            if (!check_lanes(isa, "alu_imm", int(op), dst, ref, num_lanes, tmask))
+                return false;
+        }
+
+        for (auto op : cmp_ops) {
+            uint32_t tmask = random_tmask(num_lanes);
+            uint32_t expected = 0;
+            for (uint32_t t = 0; t < num_lanes; ++t) {
+                if (rng() & 1) {
+                    b[t] = a[t];
+                }
+                if ((tmask & (1u << t)) && eval_cmp(op, a[t], b[t])) {
+                    expected |= (1u << t);
+                }
+            }
+            uint32_t mask = cmp(op, a, b, num_lanes, tmask);
+            if (mask != expected) {
+                printf("%s: cmp op=%d lanes=%u tmask=0x%x: 0x%x, expected 0x%x\n",
+                       isa, int(op), num_lanes, tmask, mask, expected);
+                return false;
+            }
+        }
+
+        uint32_t tmask = random_tmask(num_lanes);
+        for (uint32_t t = 0; t < num_lanes; ++t) {
+            dst[t] = ref[t] = rng();
+            if (tmask & (1u << t)) {
+                ref[t] = imm;
+            }
+        }
+        fill(dst, imm, num_lanes, tmask);
+        if (!check_lanes(isa, "fill", 0, dst, ref, num_lanes, tmask))
+            return false;
+    }
+    return true;
+}
+
+int main() {
+    for (auto isa : supported_isas()) {
+        if (!set_isa(isa) || !test_isa(isa)) {
+            printf("FAILED!\n");
+            return -1;
+        }
+        printf("lanes: %s\n", isa);
+    }
+
+    printf("PASSED!\n");
+
+    return 0;
+}